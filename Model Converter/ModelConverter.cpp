@@ -0,0 +1,393 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+
+#include "ModelImporter.h"
+#include "ModelCache.h"
+#include "TextureCompressor.h"
+#include "FileUtils.h"
+#include "MeshCodec.h"
+#include "Hash.h"
+#include "IndexOptimizer.h"
+
+namespace fs = std::filesystem;
+
+
+/*******************************************************
+Headless batch converter. Imports every obj/dae file found
+in the given files/folders (recursively) on a thread pool,
+without creating an OpenGL context.
+
+Usage: ModelConverter [-o outputDir] [-j threads] [--no-cache] [--no-reorder] [--no-batch] [--compress] [--verify] <file|folder>...
+       ModelConverter --self-test
+
+For each model the converter writes:
+  - <outputDir>/<model>.bin  binary mesh blob (import cache format)
+  - <outputDir>/<texture>.dds block compressed texture + mips
+If no output folder is given, the import cache is still warmed.
+--compress stores the mesh vertex data with the mesh codec and
+--verify decodes it again and reports the worst round trip error.
+--no-reorder keeps the triangle and vertex order of the source file,
+the vertex cache miss rates of both orders are reported otherwise.
+--no-batch keeps every mesh of the source file separate instead of
+merging the meshes that share a material.
+--self-test round trips the mesh codec's entropy coder over adversarial
+byte distributions and exits with the result.
+********************************************************/
+
+
+///////////////////////////////////////////////////
+// DataTypes
+struct ConvertJob {
+	std::string path;
+	std::string relativePath; // relative to the folder it was found in
+};
+
+struct ConvertResult {
+	bool success = false;
+	uintmax_t inputBytes = 0;
+	size_t numMeshes = 0;	// in the source file
+	size_t numBatches = 0;	// meshes left once those sharing a material are merged
+	size_t numTriangles = 0;
+	size_t numTextures = 0;
+	size_t rawGeometryBytes = 0;
+	size_t storedGeometryBytes = 0;
+	VertexCacheStats sourceVertexCache;	// empty when the model came from the cache
+	VertexCacheStats vertexCache;
+	CodecError codecError;
+	double seconds = 0.0;
+};
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+bool parseArguments(int argc, char** argv);
+void collectJobs(const std::string& inputPath);
+void workerThread();
+ConvertResult convertModel(const ConvertJob& job);
+void printSummary(double wallSeconds);
+void printUsage();
+
+
+///////////////////////////////////////////////////
+// Global Vars
+std::string outputDir;
+unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency());
+ImportOptions importOptions;
+bool compressMeshes = false;
+bool verifyMeshes = false;
+bool selfTest = false;
+
+std::vector<std::string> inputPaths;
+std::vector<ConvertJob> jobs;
+std::vector<ConvertResult> results;
+std::atomic<size_t> nextJob(0);
+std::mutex outputMutex;
+
+
+int main(int argc, char** argv)
+{
+	if (!parseArguments(argc, argv)) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	if (selfTest) {
+		bool passed = testEntropyCoder();
+		std::cout << "Self test " << (passed ? "passed" : "FAILED") << std::endl;
+		return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	for (unsigned int i = 0; i < inputPaths.size(); i++)
+		collectJobs(inputPaths[i]);
+
+	if (jobs.empty()) {
+		std::cout << "ERROR->" << __FUNCTION__ << ": No obj or dae files found" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Converting " << jobs.size() << " models on " << numThreads << " threads" << std::endl << std::endl;
+
+	results.resize(jobs.size());
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < std::min<size_t>(numThreads, jobs.size()); i++)
+		workers.push_back(std::thread(workerThread));
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printSummary(wallSeconds);
+
+	for (unsigned int i = 0; i < results.size(); i++)
+		if (!results[i].success)
+			return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
+
+bool parseArguments(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "-o" && i + 1 < argc) {
+			outputDir = argv[++i];
+		}
+		else if (arg == "-j" && i + 1 < argc) {
+			numThreads = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--no-cache") {
+			importOptions.useCache = false;
+		}
+		else if (arg == "--no-reorder") {
+			importOptions.optimizeIndexOrder = false;
+		}
+		else if (arg == "--no-batch") {
+			importOptions.batchByMaterial = false;
+		}
+		else if (arg == "--compress") {
+			compressMeshes = true;
+		}
+		else if (arg == "--verify") {
+			verifyMeshes = true;
+		}
+		else if (arg == "--self-test") {
+			selfTest = true;
+		}
+		else if (arg[0] == '-') {
+			std::cout << "ERROR->" << __FUNCTION__ << ": Unknown option '" << arg << "'" << std::endl;
+			return false;
+		}
+		else {
+			inputPaths.push_back(arg);
+		}
+	}
+
+	return selfTest || !inputPaths.empty();
+}
+
+void collectJobs(const std::string& inputPath) {
+	std::error_code error;
+
+	if (fs::is_regular_file(inputPath, error)) {
+		ConvertJob job;
+		job.path = inputPath;
+		job.relativePath = fs::path(inputPath).filename().string();
+		jobs.push_back(job);
+		return;
+	}
+
+	if (!fs::is_directory(inputPath, error)) {
+		std::cout << "WARN->" << __FUNCTION__ << ": '" << inputPath << "' is not a valid file or folder" << std::endl;
+		return;
+	}
+
+	for (fs::recursive_directory_iterator it(inputPath, error), end; !error && it != end; it.increment(error)) {
+		if (!it->is_regular_file(error) || getModelFormat(it->path().string()) == ModelFormat::UNSUPPORTED)
+			continue;
+
+		ConvertJob job;
+		job.path = it->path().string();
+		job.relativePath = fs::relative(it->path(), inputPath, error).string();
+		jobs.push_back(job);
+	}
+}
+
+void workerThread() {
+	while (true) {
+		size_t jobIndex = nextJob++;
+		if (jobIndex >= jobs.size())
+			return;
+
+		results[jobIndex] = convertModel(jobs[jobIndex]);
+
+		std::lock_guard<std::mutex> lock(outputMutex);
+		ConvertResult& result = results[jobIndex];
+
+		std::cout << (result.success ? "  OK   " : "  FAIL ") << jobs[jobIndex].path
+			<< " (" << result.numMeshes << " meshes";
+		if (result.numBatches < result.numMeshes)
+			std::cout << " in " << result.numBatches << " batches";
+		std::cout << ", " << result.numTriangles << " triangles, "
+			<< result.numTextures << " textures) " << result.seconds * 1000.0 << "ms" << std::endl;
+
+		if (result.success) {
+			std::cout << "         vertex cache: ACMR ";
+			if (result.sourceVertexCache.triangles > 0)
+				std::cout << result.sourceVertexCache.acmr() << " -> ";
+			std::cout << result.vertexCache.acmr() << ", ATVR ";
+			if (result.sourceVertexCache.triangles > 0)
+				std::cout << result.sourceVertexCache.atvr() << " -> ";
+			std::cout << result.vertexCache.atvr() << std::endl;
+		}
+
+		if (compressMeshes && result.success) {
+			std::cout << "         geometry " << result.rawGeometryBytes << " -> " << result.storedGeometryBytes << " bytes";
+			if (verifyMeshes) {
+				std::cout << ", max error: position " << result.codecError.maxPositionError
+					<< ", normal " << result.codecError.maxNormalError << " deg"
+					<< ", uv " << result.codecError.maxUvError;
+			}
+			std::cout << std::endl;
+		}
+	}
+}
+
+ConvertResult convertModel(const ConvertJob& job) {
+	ConvertResult result;
+	auto start = std::chrono::steady_clock::now();
+
+	std::error_code error;
+	result.inputBytes = fs::file_size(job.path, error);
+
+	Model model;
+	model.path = job.path;
+
+	if (!importModel(model, importOptions) || model.meshes.empty()) {
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	}
+
+	result.success = true;
+	result.numBatches = model.meshes.size();
+	result.sourceVertexCache = model.sourceVertexCache;
+
+	std::vector<std::string> texturePaths;
+
+	for (unsigned int i = 0; i < model.meshes.size(); i++) {
+		Mesh& mesh = model.meshes[i];
+		result.numMeshes += std::max<size_t>(mesh.parts.size(), 1);
+		result.numTriangles += mesh.vecData.elementCount() / 3;
+		result.vertexCache.add(measureVertexCache(mesh.vecData.indices));
+
+		if (!mesh.mtlData.map_d.empty())
+			texturePaths.push_back(mesh.mtlData.map_d);
+		if (!mesh.mtlData.map_Kd.empty())
+			texturePaths.push_back(mesh.mtlData.map_Kd);
+
+		if (compressMeshes) {
+			mesh.compression = MeshCompression::QUANTIZED;
+
+			std::vector<unsigned char> encoded = encodeVecData(mesh.vecData);
+			result.rawGeometryBytes += mesh.vecData.vertices.size() * sizeof(glm::vec3)
+				+ mesh.vecData.normals.size() * sizeof(glm::vec3)
+				+ mesh.vecData.uvs.size() * sizeof(glm::vec2)
+				+ mesh.vecData.indices.size() * sizeof(unsigned int);
+			result.storedGeometryBytes += encoded.size();
+
+			if (verifyMeshes) {
+				VecData decoded;
+				if (!decodeVecData(encoded.data(), encoded.size(), decoded)) {
+					std::cout << "ERROR->" << __FUNCTION__ << ": Mesh " << i << " of '" << job.path << "' failed to decode" << std::endl;
+					result.success = false;
+					continue;
+				}
+
+				CodecError error = measureCodecError(mesh.vecData, decoded);
+				if (!error.sizesMatch) {
+					std::cout << "ERROR->" << __FUNCTION__ << ": Mesh " << i << " of '" << job.path << "' decoded to a different size" << std::endl;
+					result.success = false;
+				}
+
+				result.codecError.maxPositionError = std::max(result.codecError.maxPositionError, error.maxPositionError);
+				result.codecError.maxNormalError = std::max(result.codecError.maxNormalError, error.maxNormalError);
+				result.codecError.maxUvError = std::max(result.codecError.maxUvError, error.maxUvError);
+			}
+		}
+	}
+
+	if (!outputDir.empty()) {
+		///////////////////////////////////////////////////
+		// Write the binary mesh blob
+		fs::path outputPath = fs::path(outputDir) / job.relativePath;
+		outputPath.replace_extension(".bin");
+
+		if (!writeFileAtomic(outputPath.string(), serializeModel(model, hashFile(model.path)))) {
+			std::cout << "ERROR->" << __FUNCTION__ << ": Could not write '" << outputPath.string() << "'" << std::endl;
+			result.success = false;
+		}
+
+		///////////////////////////////////////////////////
+		// Compress the textures (next to the blob, same relative name)
+		std::sort(texturePaths.begin(), texturePaths.end());
+		texturePaths.erase(std::unique(texturePaths.begin(), texturePaths.end()), texturePaths.end());
+
+		std::string meshDir = model.meshes[0].path;
+
+		for (unsigned int i = 0; i < texturePaths.size(); i++) {
+			CompressedTexture texture;
+			if (!compressTexture(meshDir + "\\" + texturePaths[i], texture)) {
+				std::cout << "WARN->" << __FUNCTION__ << ": Could not load texture '" << texturePaths[i] << "'" << std::endl;
+				continue;
+			}
+
+			fs::path texturePath = outputPath.parent_path() / texturePaths[i];
+			texturePath.replace_extension(".dds");
+
+			if (writeDds(texturePath.string(), texture))
+				result.numTextures++;
+		}
+	}
+
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return result;
+}
+
+void printSummary(double wallSeconds) {
+	size_t numSucceeded = 0;
+	uintmax_t totalBytes = 0;
+	size_t totalTriangles = 0;
+	size_t rawGeometryBytes = 0;
+	size_t storedGeometryBytes = 0;
+	double totalSeconds = 0.0;
+
+	for (unsigned int i = 0; i < results.size(); i++) {
+		if (results[i].success)
+			numSucceeded++;
+		totalBytes += results[i].inputBytes;
+		totalTriangles += results[i].numTriangles;
+		rawGeometryBytes += results[i].rawGeometryBytes;
+		storedGeometryBytes += results[i].storedGeometryBytes;
+		totalSeconds += results[i].seconds;
+	}
+
+	double megabytes = totalBytes / (1024.0 * 1024.0);
+
+	std::cout << std::endl;
+	std::cout << "Converted " << numSucceeded << "/" << results.size() << " models in " << wallSeconds << "s" << std::endl;
+	std::cout << "  Input:      " << megabytes << " MB, " << totalTriangles << " triangles" << std::endl;
+	std::cout << "  Throughput: " << results.size() / wallSeconds << " files/s, "
+		<< megabytes / wallSeconds << " MB/s, "
+		<< totalTriangles / wallSeconds / 1000000.0 << " Mtris/s" << std::endl;
+	std::cout << "  Speedup:    " << totalSeconds / wallSeconds << "x over serial (" << numThreads << " threads)" << std::endl;
+
+	if (compressMeshes && storedGeometryBytes > 0) {
+		std::cout << "  Geometry:   " << rawGeometryBytes / (1024.0 * 1024.0) << " MB -> "
+			<< storedGeometryBytes / (1024.0 * 1024.0) << " MB ("
+			<< (double)rawGeometryBytes / storedGeometryBytes << ":1)" << std::endl;
+	}
+}
+
+void printUsage() {
+	std::cout << "Usage: ModelConverter [-o outputDir] [-j threads] [--no-cache] [--no-reorder] [--no-batch] [--compress] [--verify] <file|folder>..." << std::endl;
+	std::cout << "       ModelConverter --self-test" << std::endl;
+	std::cout << "  -o            write binary meshes and dds textures to this folder" << std::endl;
+	std::cout << "  -j            number of worker threads (default: all cores)" << std::endl;
+	std::cout << "  --no-cache    always parse the source files" << std::endl;
+	std::cout << "  --no-reorder  keep the source triangle and vertex order" << std::endl;
+	std::cout << "  --no-batch    keep meshes sharing a material separate" << std::endl;
+	std::cout << "  --compress    store mesh vertex data quantized and entropy coded" << std::endl;
+	std::cout << "  --verify      decode compressed meshes and report the round trip error" << std::endl;
+	std::cout << "  --self-test   round trip the entropy coder over adversarial data and exit" << std::endl;
+}
@@ -0,0 +1,307 @@
+#include "TextureCompressor.h"
+#include "FileUtils.h"
+#include "stb_image.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+
+///////////////////////////////////////////////////
+// DataTypes
+struct DdsPixelFormat {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t rgbBitCount;
+	uint32_t rBitMask;
+	uint32_t gBitMask;
+	uint32_t bBitMask;
+	uint32_t aBitMask;
+};
+
+struct DdsHeader {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DdsPixelFormat pixelFormat;
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+};
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+void compressLevel(const std::vector<unsigned char>& rgba, int width, int height, TextureFormat format, std::vector<unsigned char>& blocks);
+void encodeColourBlock(const unsigned char* block, unsigned char* out);
+void encodeAlphaBlock(const unsigned char* block, unsigned char* out);
+void downsample(const std::vector<unsigned char>& src, int width, int height, std::vector<unsigned char>& dst);
+uint16_t packRgb565(const float* colour);
+void unpackRgb565(uint16_t packed, int* colour);
+
+
+bool compressTexture(const std::string& path, CompressedTexture& texture) {
+	int width, height, nrChannels;
+
+	// always expand to rgba so the block encoders only deal with one layout
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 4);
+	if (!data)
+		return false;
+
+	std::vector<unsigned char> level(data, data + width * height * 4);
+	stbi_image_free(data);
+
+	texture.width = width;
+	texture.height = height;
+	texture.format = (nrChannels == 4 || nrChannels == 2) ? TextureFormat::BC3 : TextureFormat::BC1;
+	texture.mipLevels.clear();
+
+	while (true) {
+		std::vector<unsigned char> blocks;
+		compressLevel(level, width, height, texture.format, blocks);
+		texture.mipLevels.push_back(blocks);
+
+		if (width == 1 && height == 1)
+			break;
+
+		std::vector<unsigned char> nextLevel;
+		downsample(level, width, height, nextLevel);
+
+		level.swap(nextLevel);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	return true;
+}
+
+bool writeDds(const std::string& path, const CompressedTexture& texture) {
+	DdsHeader header;
+	memset(&header, 0, sizeof(header));
+
+	header.size = sizeof(DdsHeader);
+	header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mip count, linear size
+	header.height = texture.height;
+	header.width = texture.width;
+	header.pitchOrLinearSize = texture.mipLevels.empty() ? 0 : (uint32_t)texture.mipLevels[0].size();
+	header.mipMapCount = (uint32_t)texture.mipLevels.size();
+	header.pixelFormat.size = sizeof(DdsPixelFormat);
+	header.pixelFormat.flags = 0x4; // four cc
+	header.pixelFormat.fourCC = texture.format == TextureFormat::BC1 ? 0x31545844 : 0x35545844; // "DXT1" / "DXT5"
+	header.caps = 0x1000 | 0x8 | 0x400000; // texture, complex, mipmap
+
+	std::vector<char> contents;
+	const char* magic = "DDS ";
+	contents.insert(contents.end(), magic, magic + 4);
+	contents.insert(contents.end(), (const char*)&header, (const char*)&header + sizeof(header));
+
+	for (unsigned int i = 0; i < texture.mipLevels.size(); i++)
+		contents.insert(contents.end(), texture.mipLevels[i].begin(), texture.mipLevels[i].end());
+
+	return writeFileAtomic(path, contents);
+}
+
+
+void compressLevel(const std::vector<unsigned char>& rgba, int width, int height, TextureFormat format, std::vector<unsigned char>& blocks) {
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	int blockBytes = format == TextureFormat::BC1 ? 8 : 16;
+
+	blocks.resize(blocksX * blocksY * blockBytes);
+
+	unsigned char block[16 * 4];
+
+	for (int by = 0; by < blocksY; by++) {
+		for (int bx = 0; bx < blocksX; bx++) {
+			// gather the 4x4 block, clamping at the image edges
+			for (int y = 0; y < 4; y++) {
+				for (int x = 0; x < 4; x++) {
+					int srcX = std::min(bx * 4 + x, width - 1);
+					int srcY = std::min(by * 4 + y, height - 1);
+					memcpy(&block[(y * 4 + x) * 4], &rgba[(srcY * width + srcX) * 4], 4);
+				}
+			}
+
+			unsigned char* out = &blocks[(by * blocksX + bx) * blockBytes];
+
+			if (format == TextureFormat::BC3) {
+				encodeAlphaBlock(block, out);
+				out += 8;
+			}
+
+			encodeColourBlock(block, out);
+		}
+	}
+}
+
+void encodeColourBlock(const unsigned char* block, unsigned char* out) {
+	///////////////////////////////////////////////////
+	// Find the principal axis of the block colours
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += block[i * 4 + c] / 16.0f;
+
+	float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		float r = block[i * 4 + 0] - mean[0];
+		float g = block[i * 4 + 1] - mean[1];
+		float b = block[i * 4 + 2] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+	}
+
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iter = 0; iter < 4; iter++) {
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float length = std::max(std::max(fabsf(x), fabsf(y)), fabsf(z));
+		if (length < 1e-6f)
+			break;
+		axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+	}
+
+	///////////////////////////////////////////////////
+	// Endpoints are the extreme colours along the axis
+	float minProj = 1e30f, maxProj = -1e30f;
+	int minIndex = 0, maxIndex = 0;
+	for (int i = 0; i < 16; i++) {
+		float proj = block[i * 4 + 0] * axis[0] + block[i * 4 + 1] * axis[1] + block[i * 4 + 2] * axis[2];
+		if (proj < minProj) { minProj = proj; minIndex = i; }
+		if (proj > maxProj) { maxProj = proj; maxIndex = i; }
+	}
+
+	float maxColour[3] = { (float)block[maxIndex * 4], (float)block[maxIndex * 4 + 1], (float)block[maxIndex * 4 + 2] };
+	float minColour[3] = { (float)block[minIndex * 4], (float)block[minIndex * 4 + 1], (float)block[minIndex * 4 + 2] };
+
+	uint16_t colour0 = packRgb565(maxColour);
+	uint16_t colour1 = packRgb565(minColour);
+
+	// colour0 > colour1 selects the 4 colour mode
+	if (colour0 < colour1)
+		std::swap(colour0, colour1);
+
+	uint32_t indices = 0;
+
+	if (colour0 != colour1) {
+		int palette[4][3];
+		unpackRgb565(colour0, palette[0]);
+		unpackRgb565(colour1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++) {
+			int bestIndex = 0;
+			int bestDistance = INT32_MAX;
+
+			for (int p = 0; p < 4; p++) {
+				int dr = block[i * 4 + 0] - palette[p][0];
+				int dg = block[i * 4 + 1] - palette[p][1];
+				int db = block[i * 4 + 2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= (uint32_t)bestIndex << (i * 2);
+		}
+	}
+
+	memcpy(out, &colour0, 2);
+	memcpy(out + 2, &colour1, 2);
+	memcpy(out + 4, &indices, 4);
+}
+
+void encodeAlphaBlock(const unsigned char* block, unsigned char* out) {
+	unsigned char alpha0 = 0, alpha1 = 255;
+	for (int i = 0; i < 16; i++) {
+		alpha0 = std::max(alpha0, block[i * 4 + 3]);
+		alpha1 = std::min(alpha1, block[i * 4 + 3]);
+	}
+
+	uint64_t indices = 0;
+
+	if (alpha0 != alpha1) {
+		// alpha0 > alpha1 selects the 8 value mode
+		int palette[8];
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		for (int p = 1; p < 7; p++)
+			palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+
+		for (int i = 0; i < 16; i++) {
+			int bestIndex = 0;
+			int bestDistance = INT32_MAX;
+
+			for (int p = 0; p < 8; p++) {
+				int distance = abs(block[i * 4 + 3] - palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= (uint64_t)bestIndex << (i * 3);
+		}
+	}
+
+	out[0] = alpha0;
+	out[1] = alpha1;
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (unsigned char)(indices >> (i * 8));
+}
+
+void downsample(const std::vector<unsigned char>& src, int width, int height, std::vector<unsigned char>& dst) {
+	int dstWidth = std::max(1, width / 2);
+	int dstHeight = std::max(1, height / 2);
+
+	dst.resize(dstWidth * dstHeight * 4);
+
+	// 2x2 box filter
+	for (int y = 0; y < dstHeight; y++) {
+		for (int x = 0; x < dstWidth; x++) {
+			int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+			int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+
+			for (int c = 0; c < 4; c++) {
+				int sum = src[(y0 * width + x0) * 4 + c] + src[(y0 * width + x1) * 4 + c]
+					+ src[(y1 * width + x0) * 4 + c] + src[(y1 * width + x1) * 4 + c];
+				dst[(y * dstWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+uint16_t packRgb565(const float* colour) {
+	int r = (int)(colour[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int)(colour[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int)(colour[2] * 31.0f / 255.0f + 0.5f);
+
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void unpackRgb565(uint16_t packed, int* colour) {
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+
+	colour[0] = (r << 3) | (r >> 2);
+	colour[1] = (g << 2) | (g >> 4);
+	colour[2] = (b << 3) | (b >> 2);
+}
@@ -0,0 +1,28 @@
+#ifndef TEXTURECOMPRESSOR_H
+#define TEXTURECOMPRESSOR_H
+
+#include <string>
+#include <vector>
+
+
+///////////////////////////////////////////////////
+// DataTypes
+enum class TextureFormat {
+	BC1,	// DXT1, rgb
+	BC3		// DXT5, rgb + alpha
+};
+
+struct CompressedTexture {
+	TextureFormat format;
+	int width = 0;
+	int height = 0;
+	std::vector<std::vector<unsigned char>> mipLevels; // compressed blocks, largest level first
+};
+
+
+// loads an image with stb_image and block compresses it (including a full mip chain)
+bool compressTexture(const std::string& path, CompressedTexture& texture);
+
+bool writeDds(const std::string& path, const CompressedTexture& texture);
+
+#endif
@@ -0,0 +1,50 @@
+#include "AssetRegistry.h"
+#include "ModelImporter.h"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+
+AssetRegistry assetRegistry;
+
+
+Model* AssetRegistry::getModel(const std::string& path) {
+	// different spellings of the same file share one asset
+	std::error_code error;
+	std::string key = fs::weakly_canonical(path, error).string();
+	if (error)
+		key = path;
+
+	auto found = assets.find(key);
+	if (found != assets.end()) {
+		stats.shared++;
+		return found->second;
+	}
+
+	Model* model = new Model();
+	model->path = path;
+
+	if (!importModel(*model)) {
+		delete model;
+		return NULL;
+	}
+
+	model->setupMeshes();
+	stats.imported++;
+
+	assets[key] = model;
+	models.push_back(model);
+
+	return model;
+}
+
+void AssetRegistry::clear() {
+	for (unsigned int i = 0; i < models.size(); i++) {
+		models[i]->releaseMeshes();
+		delete models[i];
+	}
+
+	assets.clear();
+	models.clear();
+}
@@ -0,0 +1,42 @@
+#ifndef ASSETREGISTRY_H
+#define ASSETREGISTRY_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "Model.h"
+
+
+///////////////////////////////////////////////////
+// Asset Registry
+// Each unique model path is imported and uploaded once. Loading the same path
+// again returns the same Model, so copies share their meshes and GPU buffers
+// and are drawn together by the render queue as instances.
+
+struct AssetRegistryStats {
+	unsigned int imported = 0;
+	unsigned int shared = 0;	// loads served by an already imported model
+};
+
+
+class AssetRegistry {
+public:
+	AssetRegistryStats stats;
+
+	// imports and sets up the model on first use, returns NULL if it cannot be imported
+	Model* getModel(const std::string& path);
+
+	// unique models, in the order they were first loaded
+	const std::vector<Model*>& getModels() const { return models; }
+
+	// releases every model (call before the context is destroyed)
+	void clear();
+private:
+	std::unordered_map<std::string, Model*> assets; // canonical path -> model
+	std::vector<Model*> models;
+};
+
+extern AssetRegistry assetRegistry;
+
+#endif
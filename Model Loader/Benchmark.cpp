@@ -0,0 +1,162 @@
+#include "Benchmark.h"
+#include "Model.h"
+#include "ShaderRegistry.h"
+#include "GLState.h"
+#include "FrameUniforms.h"
+#include "MaterialTable.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+
+///////////////////////////////////////////////////
+// DataTypes
+struct BenchmarkConfig {
+	const char* name;
+	VertexPrecision precision;
+	VertexLayout layout;
+	GLsizei strideAlignment;
+};
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+Mesh createBenchmarkMesh(int rings, int segments);
+double measureFrameTime(GLFWwindow* window, Model& model, int numFrames);
+
+
+///////////////////////////////////////////////////
+// Global Vars
+const int BENCHMARK_RINGS = 384;
+const int BENCHMARK_SEGMENTS = 384;
+const int BENCHMARK_GRID = 4;		// draws per frame = grid * grid
+const int BENCHMARK_WARMUP_FRAMES = 5;
+
+const BenchmarkConfig benchmarkConfigs[] = {
+	{ "float planar",                VertexPrecision::FULL,      VertexLayout::PLANAR,      4 },
+	{ "float interleaved",           VertexPrecision::FULL,      VertexLayout::INTERLEAVED, 4 },
+	{ "quantized planar",            VertexPrecision::QUANTIZED, VertexLayout::PLANAR,      4 },
+	{ "quantized interleaved",       VertexPrecision::QUANTIZED, VertexLayout::INTERLEAVED, 4 },
+	{ "quantized interleaved (32B)", VertexPrecision::QUANTIZED, VertexLayout::INTERLEAVED, 32 }
+};
+
+
+void runBenchmark(GLFWwindow* window, int numFrames) {
+	Mesh mesh = createBenchmarkMesh(BENCHMARK_RINGS, BENCHMARK_SEGMENTS);
+
+	size_t verticesPerFrame = mesh.vecData.indices.size() * BENCHMARK_GRID * BENCHMARK_GRID;
+
+	std::cout << "Vertex benchmark: " << mesh.vecData.vertices.size() << " vertices, "
+		<< mesh.vecData.indices.size() / 3 << " triangles, " << BENCHMARK_GRID * BENCHMARK_GRID << " draws per frame, "
+		<< numFrames << " frames" << std::endl << std::endl;
+
+	std::cout << std::left << std::setw(30) << "Format" << std::setw(14) << "Bytes/vertex"
+		<< std::setw(14) << "Vertex MB" << std::setw(14) << "ms/frame" << "Mverts/s" << std::endl;
+
+	std::cout << std::fixed << std::setprecision(2);
+
+	glState.setEnabled(GL_DEPTH_TEST, true);
+
+	for (const BenchmarkConfig& config : benchmarkConfigs) {
+		Model model;
+		model.path = config.name;
+
+		mesh.precision = config.precision;
+		mesh.layout = config.layout;
+		mesh.strideAlignment = config.strideAlignment;
+		model.meshes.push_back(mesh);
+
+		model.setupMeshes();
+		shaderRegistry.finishAll();
+
+		double milliseconds = measureFrameTime(window, model, numFrames);
+		MeshStats stats = model.getStats();
+
+		std::cout << std::left << std::setw(30) << config.name
+			<< std::setw(14) << stats.vertexBytes / mesh.vecData.vertices.size()
+			<< std::setw(14) << stats.vertexBytes / (1024.0 * 1024.0)
+			<< std::setw(14) << milliseconds
+			<< verticesPerFrame / (milliseconds * 1000.0) << std::endl;
+
+		model.releaseMeshes();
+	}
+}
+
+
+double measureFrameTime(GLFWwindow* window, Model& model, int numFrames) {
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
+
+	double totalMilliseconds = 0.0;
+
+	for (int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + numFrames; frame++) {
+		auto start = std::chrono::steady_clock::now();
+
+		glClearColor(0.25f, 0.25f, 0.25f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		frameUniforms.begin(view, projection);
+		materialTable.bind();
+
+		// small spheres, so rasterisation stays cheap compared to the vertex work
+		for (int x = 0; x < BENCHMARK_GRID; x++) {
+			for (int y = 0; y < BENCHMARK_GRID; y++) {
+				glm::vec3 position((x - (BENCHMARK_GRID - 1) * 0.5f) * 1.5f, (y - (BENCHMARK_GRID - 1) * 0.5f) * 1.5f, 0.0f);
+				glm::mat4 modelTrans = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.1f));
+
+				model.draw(modelTrans);
+			}
+		}
+
+		frameUniforms.end();
+		glFinish();
+
+		if (frame >= BENCHMARK_WARMUP_FRAMES)
+			totalMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+	}
+
+	return totalMilliseconds / numFrames;
+}
+
+
+Mesh createBenchmarkMesh(int rings, int segments) {
+	Mesh mesh;
+	mesh.meshType = MeshType::OBJ;
+	mesh.mtlData.Kd = glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
+
+	VecData& vecData = mesh.vecData;
+
+	for (int ring = 0; ring <= rings; ring++) {
+		float theta = glm::pi<float>() * ring / rings;
+
+		for (int segment = 0; segment <= segments; segment++) {
+			float phi = 2.0f * glm::pi<float>() * segment / segments;
+			glm::vec3 normal(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+
+			vecData.vertices.push_back(normal);
+			vecData.normals.push_back(normal);
+			vecData.uvs.push_back(glm::vec2((float)segment / segments, (float)ring / rings));
+		}
+	}
+
+	for (int ring = 0; ring < rings; ring++) {
+		for (int segment = 0; segment < segments; segment++) {
+			unsigned int a = ring * (segments + 1) + segment;
+			unsigned int b = a + segments + 1;
+
+			vecData.indices.insert(vecData.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+
+	return mesh;
+}
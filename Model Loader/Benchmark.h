@@ -0,0 +1,15 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <GLFW/glfw3.h>
+
+
+///////////////////////////////////////////////////
+// Vertex Benchmark
+// Draws a dense procedural sphere many times at a small size on screen, so the
+// frame time is bound by vertex fetch and processing rather than by fill rate.
+// Every vertex format is measured in turn and the results printed as a table.
+
+void runBenchmark(GLFWwindow* window, int numFrames);
+
+#endif
@@ -0,0 +1,111 @@
+#include "FileUtils.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <random>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+
+bool readFileBytes(const std::string& path, std::vector<char>& contents) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamsize size = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	contents.resize((size_t)size);
+	if (size > 0 && !file.read(contents.data(), size))
+		return false;
+
+	return true;
+}
+
+bool writeFileAtomic(const std::string& path, const std::vector<char>& contents) {
+	std::error_code error;
+	fs::path target(path);
+
+	if (target.has_parent_path())
+		fs::create_directories(target.parent_path(), error);
+
+	// unique temp name so concurrent writers never share a file
+	std::random_device random;
+	size_t threadId = std::hash<std::thread::id>()(std::this_thread::get_id());
+	std::string tmpPath = path + "." + std::to_string(random() ^ threadId) + ".tmp";
+
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(contents.data(), contents.size());
+		file.flush();
+
+		if (!file.good()) {
+			file.close();
+			fs::remove(tmpPath, error);
+			return false;
+		}
+	}
+
+	// rename replaces any existing file in one step
+	fs::rename(tmpPath, target, error);
+	if (error) {
+		fs::remove(tmpPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+void touchFile(const std::string& path) {
+	std::error_code error;
+	fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+}
+
+void evictOldestFiles(const std::string& directory, uintmax_t maxBytes) {
+	struct CacheEntry {
+		fs::path path;
+		uintmax_t size;
+		fs::file_time_type lastUsed;
+	};
+
+	std::error_code error;
+	std::vector<CacheEntry> entries;
+	uintmax_t totalBytes = 0;
+
+	for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+		if (!it->is_regular_file(error))
+			continue;
+
+		CacheEntry entry;
+		entry.path = it->path();
+		entry.size = it->file_size(error);
+		entry.lastUsed = it->last_write_time(error);
+
+		if (error) {
+			// another process may have evicted the file already
+			error.clear();
+			continue;
+		}
+
+		totalBytes += entry.size;
+		entries.push_back(entry);
+	}
+
+	if (totalBytes <= maxBytes)
+		return;
+
+	std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) {
+		return a.lastUsed < b.lastUsed;
+	});
+
+	for (unsigned int i = 0; i < entries.size() && totalBytes > maxBytes; i++) {
+		fs::remove(entries[i].path, error);
+		totalBytes -= entries[i].size;
+	}
+}
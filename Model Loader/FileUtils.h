@@ -0,0 +1,21 @@
+#ifndef FILEUTILS_H
+#define FILEUTILS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+// reads a whole file into memory, returns false if the file cannot be opened
+bool readFileBytes(const std::string& path, std::vector<char>& contents);
+
+// writes to a temporary file and renames it into place, so readers never see a partial file
+bool writeFileAtomic(const std::string& path, const std::vector<char>& contents);
+
+// updates the modification time of a file (used as the LRU timestamp by the caches)
+void touchFile(const std::string& path);
+
+// removes the least recently used files in a directory until it fits within maxBytes
+void evictOldestFiles(const std::string& directory, uintmax_t maxBytes);
+
+#endif
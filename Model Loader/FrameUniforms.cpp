@@ -0,0 +1,31 @@
+#include "FrameUniforms.h"
+#include "Shader.h"
+
+#include <cstring>
+
+
+///////////////////////////////////////////////////
+// Global Vars
+FrameUniforms frameUniforms;
+
+
+void FrameUniforms::begin(const glm::mat4& view, const glm::mat4& projection) {
+	CameraBlock block;
+	block.view = view;
+	block.projection = projection;
+	block.viewProjection = projection * view;
+	block.position = glm::inverse(view)[3];
+
+	memcpy(ring.map(sizeof(CameraBlock)), &block, sizeof(CameraBlock));
+	ring.unmap();
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, ring.getBuffer(), ring.getOffset(), sizeof(CameraBlock));
+}
+
+void FrameUniforms::end() {
+	ring.fence();
+}
+
+void FrameUniforms::release() {
+	ring.release();
+}
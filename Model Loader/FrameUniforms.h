@@ -0,0 +1,43 @@
+#ifndef FRAMEUNIFORMS_H
+#define FRAMEUNIFORMS_H
+
+#include <glm/glm.hpp>
+
+#include "StreamRing.h"
+
+
+///////////////////////////////////////////////////
+// Frame Uniforms
+// Camera data shared by every program, written once per frame into a std140
+// uniform block (Camera in shader.vs) instead of being set on each program.
+// Programs are pointed at CAMERA_BLOCK_BINDING when they are linked, so the
+// block is bound once per frame and survives program changes.
+
+// std140 layout of the Camera block
+struct CameraBlock {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec4 position;	// world space, w unused
+};
+
+
+class FrameUniforms {
+public:
+	// writes and binds the camera block for this frame
+	void begin(const glm::mat4& view, const glm::mat4& projection);
+
+	// call after the frame's draws, so the block is not rewritten while the GPU still reads it
+	void end();
+
+	// deletes the buffer (call before the context is destroyed)
+	void release();
+
+	const StreamStats& getStats() const { return ring.stats; }
+private:
+	StreamRing ring = StreamRing(GL_UNIFORM_BUFFER);
+};
+
+extern FrameUniforms frameUniforms;
+
+#endif
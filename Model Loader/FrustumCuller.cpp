@@ -0,0 +1,154 @@
+#include "FrustumCuller.h"
+
+#include <xmmintrin.h>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+
+
+bool ItemKey::operator<(const ItemKey& other) const {
+	if (mesh != other.mesh)
+		return mesh < other.mesh;
+
+	return memcmp(&transform, &other.transform, sizeof(glm::mat4)) < 0;
+}
+
+
+void FrustumCuller::begin(const glm::mat4& view, const glm::mat4& projection) {
+	frustum = extractFrustum(projection * view);
+
+	items.clear();
+	accepted.clear();
+	centreX.clear();
+	centreY.clear();
+	centreZ.clear();
+	radius.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+void FrustumCuller::add(Mesh& mesh, const glm::mat4& transform) {
+	CullItem item;
+	item.mesh = &mesh;
+	item.transform = transform;
+	items.push_back(item);
+
+	const MeshBounds& bounds = mesh.bounds;
+
+	///////////////////////////////////////////////////
+	// Object to world space
+	glm::vec3 centre, extent;
+	transformBounds(bounds, transform, centre, extent);
+
+	// the sphere grows by the largest axis scale
+	float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+	centreX.push_back(centre.x);
+	centreY.push_back(centre.y);
+	centreZ.push_back(centre.z);
+	radius.push_back(bounds.radius * scale);
+	extentX.push_back(extent.x);
+	extentY.push_back(extent.y);
+	extentZ.push_back(extent.z);
+}
+
+void FrustumCuller::accept(Mesh& mesh, const glm::mat4& transform) {
+	CullItem item;
+	item.mesh = &mesh;
+	item.transform = transform;
+	accepted.push_back(item);
+}
+
+const std::vector<CullItem>& FrustumCuller::cull() {
+	auto start = std::chrono::steady_clock::now();
+
+	visible = accepted;
+
+	// the last group of four is padded, padded lanes are never read back
+	size_t count = items.size();
+	size_t padded = (count + 3) & ~(size_t)3;
+
+	centreX.resize(padded, 0.0f);
+	centreY.resize(padded, 0.0f);
+	centreZ.resize(padded, 0.0f);
+	radius.resize(padded, 0.0f);
+	extentX.resize(padded, 0.0f);
+	extentY.resize(padded, 0.0f);
+	extentZ.resize(padded, 0.0f);
+
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	for (size_t i = 0; i < padded; i += 4) {
+		__m128 cx = _mm_loadu_ps(&centreX[i]);
+		__m128 cy = _mm_loadu_ps(&centreY[i]);
+		__m128 cz = _mm_loadu_ps(&centreZ[i]);
+		__m128 r = _mm_loadu_ps(&radius[i]);
+		__m128 ex = _mm_loadu_ps(&extentX[i]);
+		__m128 ey = _mm_loadu_ps(&extentY[i]);
+		__m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+		__m128 outside = _mm_setzero_ps();
+
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			__m128 px = _mm_set1_ps(plane.x);
+			__m128 py = _mm_set1_ps(plane.y);
+			__m128 pz = _mm_set1_ps(plane.z);
+
+			// signed distance from the plane to the shared centre
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)), _mm_add_ps(_mm_mul_ps(pz, cz), _mm_set1_ps(plane.w)));
+
+			// the box reaches |n| . extent towards the plane, the tighter of the two volumes decides
+			__m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, px), ex), _mm_mul_ps(_mm_andnot_ps(signMask, py), ey)), _mm_mul_ps(_mm_andnot_ps(signMask, pz), ez));
+			__m128 reach = _mm_min_ps(r, boxRadius);
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_xor_ps(reach, signMask)));
+		}
+
+		int outsideMask = _mm_movemask_ps(outside);
+
+		for (size_t lane = 0; lane < 4 && i + lane < count; lane++) {
+			if (!(outsideMask & (1 << lane)))
+				visible.push_back(items[i + lane]);
+		}
+	}
+
+	stats.tested = count;
+	stats.visible = visible.size();
+	stats.culled = count + accepted.size() - visible.size();
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return visible;
+}
+
+
+void transformBounds(const MeshBounds& bounds, const glm::mat4& transform, glm::vec3& centre, glm::vec3& extent) {
+	centre = glm::vec3(transform * glm::vec4(bounds.centre, 1.0f));
+
+	glm::mat3 absolute = glm::mat3(transform);
+	for (int column = 0; column < 3; column++)
+		absolute[column] = glm::abs(absolute[column]);
+
+	extent = absolute * ((bounds.max - bounds.min) * 0.5f);
+}
+
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+	// rows of the matrix (glm is column major)
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[3] + rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+
+	for (int i = 0; i < 6; i++)
+		frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+
+	return frustum;
+}
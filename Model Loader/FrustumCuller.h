@@ -0,0 +1,77 @@
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+
+///////////////////////////////////////////////////
+// Frustum Culler
+// Meshes are added with their transform before they are submitted. Their
+// bounds are moved into world space and stored as separate arrays (centre,
+// sphere radius and box extents), so cull() can test four meshes at a time
+// against the six planes of the view projection matrix with SSE.
+// A mesh is culled when its sphere or its box lies behind any plane.
+
+struct Frustum {
+	glm::vec4 planes[6]; // left, right, bottom, top, near, far (xyz normal pointing inwards, w distance)
+};
+
+struct CullItem {
+	Mesh* mesh;
+	glm::mat4 transform;
+};
+
+// Identifies a mesh copy across frames, for state kept per copy
+struct ItemKey {
+	const Mesh* mesh;
+	glm::mat4 transform;
+
+	bool operator<(const ItemKey& other) const;
+};
+
+// Counters for the last culled frame
+struct CullStats {
+	unsigned int tested = 0;		// meshes tested by the SIMD kernel (accepted meshes are not)
+	unsigned int visible = 0;
+	unsigned int culled = 0;
+	double milliseconds = 0.0;
+};
+
+
+class FrustumCuller {
+public:
+	CullStats stats;
+
+	void begin(const glm::mat4& view, const glm::mat4& projection);
+	void add(Mesh& mesh, const glm::mat4& transform);
+
+	// for meshes already known to be inside the frustum (e.g. a scene BVH node fully inside), skips the test
+	void accept(Mesh& mesh, const glm::mat4& transform);
+
+	// tests every added mesh, returns the accepted meshes followed by the visible added ones
+	const std::vector<CullItem>& cull();
+
+	const Frustum& getFrustum() const { return frustum; }
+private:
+	Frustum frustum;
+
+	std::vector<CullItem> items;
+	std::vector<CullItem> accepted;
+	std::vector<CullItem> visible;
+
+	// world space bounds, one element per item (padded to a multiple of 4)
+	std::vector<float> centreX, centreY, centreZ;
+	std::vector<float> radius;
+	std::vector<float> extentX, extentY, extentZ;
+};
+
+// Gribb/Hartmann plane extraction, the planes are normalised
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+// world space box of transformed bounds as a centre and half size (Arvo), still enclosing the mesh
+void transformBounds(const MeshBounds& bounds, const glm::mat4& transform, glm::vec3& centre, glm::vec3& extent);
+
+#endif
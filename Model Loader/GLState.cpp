@@ -0,0 +1,105 @@
+#include "GLState.h"
+
+
+GLStateCache glState;
+
+
+GLStateCache::GLStateCache() {
+	invalidate();
+}
+
+void GLStateCache::useProgram(GLuint program) {
+	if (changed(this->program, program))
+		glUseProgram(program);
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray) {
+	if (changed(this->vertexArray, vertexArray))
+		glBindVertexArray(vertexArray);
+}
+
+void GLStateCache::bindTexture(unsigned int unit, GLuint texture) {
+	if (unit >= MAX_TEXTURE_UNITS) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		activeTexture = UNKNOWN;
+		stats.issued += 2;
+		return;
+	}
+
+	// the active unit only has to change when the binding does
+	if (textures[unit] == texture) {
+		stats.elided += 2;
+		return;
+	}
+
+	setActiveTexture(unit);
+	changed(textures[unit], texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GLStateCache::polygonMode(GLenum mode) {
+	if (changed(this->mode, mode))
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GLStateCache::setEnabled(GLenum capability, bool enabled) {
+	auto found = capabilities.find(capability);
+	if (found != capabilities.end() && found->second == enabled) {
+		stats.elided++;
+		return;
+	}
+
+	enabled ? glEnable(capability) : glDisable(capability);
+	capabilities[capability] = enabled;
+	stats.issued++;
+}
+
+void GLStateCache::blendFunc(GLenum source, GLenum destination) {
+	if (blendSource == source && blendDestination == destination) {
+		stats.elided++;
+		return;
+	}
+
+	glBlendFunc(source, destination);
+	blendSource = source;
+	blendDestination = destination;
+	stats.issued++;
+}
+
+void GLStateCache::depthMask(bool enabled) {
+	if (changed(depthWrites, enabled ? GL_TRUE : GL_FALSE))
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::invalidate() {
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeTexture = UNKNOWN;
+	mode = UNKNOWN;
+	blendSource = blendDestination = UNKNOWN;
+	depthWrites = UNKNOWN;
+
+	for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		textures[i] = UNKNOWN;
+
+	capabilities.clear();
+}
+
+
+void GLStateCache::setActiveTexture(unsigned int unit) {
+	if (changed(activeTexture, unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+// updates the shadow and counts the call, returns false if it can be dropped
+bool GLStateCache::changed(GLuint& shadow, GLuint value) {
+	if (shadow == value) {
+		stats.elided++;
+		return false;
+	}
+
+	shadow = value;
+	stats.issued++;
+	return true;
+}
@@ -0,0 +1,59 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <GL/glew.h>
+#include <unordered_map>
+
+
+///////////////////////////////////////////////////
+// GL State Cache
+// Shadows the bound program, vertex array, textures per unit, polygon mode and
+// enable flags, so calls that would not change anything are never issued.
+// Code that changes this state directly must call invalidate() afterwards.
+
+const unsigned int MAX_TEXTURE_UNITS = 32;
+
+// Counts state calls, reset by the caller (once per frame)
+struct GLStateStats {
+	unsigned int issued = 0;
+	unsigned int elided = 0;	// calls dropped because the state already matched
+};
+
+
+class GLStateCache {
+public:
+	GLStateStats stats;
+
+	GLStateCache();
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	void bindTexture(unsigned int unit, GLuint texture);	// GL_TEXTURE_2D
+	void polygonMode(GLenum mode);							// GL_FRONT_AND_BACK
+	GLenum getPolygonMode() const { return mode == UNKNOWN ? GL_FILL : mode; }
+	void setEnabled(GLenum capability, bool enabled);
+	void blendFunc(GLenum source, GLenum destination);
+	void depthMask(bool enabled);
+
+	// forgets the shadowed state, the next call of each kind is always issued
+	void invalidate();
+private:
+	// UNKNOWN marks state that has not been set through the cache
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint activeTexture;
+	GLuint textures[MAX_TEXTURE_UNITS];
+	GLenum mode;
+	GLenum blendSource, blendDestination;
+	GLuint depthWrites;
+	std::unordered_map<GLenum, bool> capabilities;
+
+	void setActiveTexture(unsigned int unit);
+	bool changed(GLuint& shadow, GLuint value);
+};
+
+extern GLStateCache glState;
+
+#endif
@@ -0,0 +1,262 @@
+#include "GeometryArena.h"
+#include "GLState.h"
+
+#include <algorithm>
+
+
+///////////////////////////////////////////////////
+// Global Vars
+GeometryArena geometryArena;
+
+// starting size of a pool, enough for most models without growing
+const unsigned int INITIAL_POOL_VERTICES = 1 << 16;
+const unsigned int INITIAL_POOL_INDICES = 3 << 16;
+
+
+bool RangeAllocator::allocate(unsigned int count, unsigned int& offset) {
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); it++) {
+		if (it->second < count)
+			continue;
+
+		offset = it->first;
+		unsigned int remaining = it->second - count;
+
+		freeRanges.erase(it);
+		if (remaining > 0)
+			freeRanges[offset + count] = remaining;
+
+		return true;
+	}
+
+	return false;
+}
+
+void RangeAllocator::free(unsigned int offset, unsigned int count) {
+	if (count == 0)
+		return;
+
+	auto next = freeRanges.lower_bound(offset);
+
+	// merge with the following range
+	if (next != freeRanges.end() && offset + count == next->first) {
+		count += next->second;
+		next = freeRanges.erase(next);
+	}
+
+	// merge with the preceding range
+	if (next != freeRanges.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			previous->second += count;
+			return;
+		}
+	}
+
+	freeRanges[offset] = count;
+}
+
+void RangeAllocator::grow(unsigned int newCapacity) {
+	if (newCapacity <= capacity)
+		return;
+
+	unsigned int oldCapacity = capacity;
+	capacity = newCapacity;
+
+	free(oldCapacity, newCapacity - oldCapacity);
+}
+
+
+bool GeometryArena::isSupported() {
+	if (supported < 0)
+		supported = GLEW_VERSION_4_3 && GLEW_ARB_shader_draw_parameters;
+
+	return supported == 1;
+}
+
+bool GeometryArena::allocate(const VertexFormat& format, const void* vertices, unsigned int vertexCount, const std::vector<unsigned int>& indices, ArenaAllocation& allocation, UploadStats& uploadStats) {
+	// every mesh in a pool is drawn with the same vertex array, so only whole interleaved vertices fit
+	if (format.layout != VertexLayout::INTERLEAVED || vertexCount == 0 || indices.empty())
+		return false;
+
+	GeometryPool* pool = getPool(format, uploadStats);
+	unsigned int vertexOffset = 0, indexOffset = 0;
+
+	///////////////////////////////////////////////////
+	// Reserve space, growing the pool buffers if needed
+	if (!pool->vertices.allocate(vertexCount, vertexOffset)) {
+		unsigned int newCapacity = std::max(pool->vertices.capacity * 2, pool->vertices.capacity + vertexCount);
+
+		growBuffer(pool->vertexBuffer, (size_t)pool->vertices.capacity * format.stride, (size_t)newCapacity * format.stride, uploadStats);
+		pool->vertices.grow(newCapacity);
+		pool->vertices.allocate(vertexCount, vertexOffset);
+
+		// the vertex array still points at the old buffer
+		setupVertexArray(*pool, uploadStats);
+	}
+
+	if (!pool->indices.allocate(indices.size(), indexOffset)) {
+		unsigned int newCapacity = std::max(pool->indices.capacity * 2, pool->indices.capacity + (unsigned int)indices.size());
+
+		growBuffer(pool->indexBuffer, (size_t)pool->indices.capacity * sizeof(GLuint), (size_t)newCapacity * sizeof(GLuint), uploadStats);
+		pool->indices.grow(newCapacity);
+		pool->indices.allocate(indices.size(), indexOffset);
+
+		setupVertexArray(*pool, uploadStats);
+	}
+
+	///////////////////////////////////////////////////
+	// Copy the mesh into its ranges
+	// (the copy target is used so the element binding of a bound vertex array is left alone)
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pool->vertexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)vertexOffset * format.stride, (size_t)vertexCount * format.stride, vertices);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pool->indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)indexOffset * sizeof(GLuint), indices.size() * sizeof(GLuint), &indices[0]);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	uploadStats.bytes += (size_t)vertexCount * format.stride + indices.size() * sizeof(GLuint);
+	uploadStats.bufferCopies += 2;
+	uploadStats.glCalls += 5;
+
+	allocation.pool = pool;
+	allocation.baseVertex = vertexOffset;
+	allocation.vertexCount = vertexCount;
+	allocation.firstIndex = indexOffset;
+	allocation.indexCount = indices.size();
+
+	pool->meshes++;
+
+	return true;
+}
+
+void GeometryArena::free(ArenaAllocation& allocation) {
+	if (allocation.pool == NULL)
+		return;
+
+	// the buffers are kept for the next mesh with the same format
+	allocation.pool->vertices.free(allocation.baseVertex, allocation.vertexCount);
+	allocation.pool->indices.free(allocation.firstIndex, allocation.indexCount);
+	allocation.pool->meshes--;
+
+	allocation = ArenaAllocation();
+}
+
+ArenaStats GeometryArena::getStats() const {
+	ArenaStats stats;
+
+	for (unsigned int i = 0; i < pools.size(); i++) {
+		const GeometryPool& pool = *pools[i];
+
+		stats.vertexBytes += (size_t)pool.vertices.capacity * pool.format.stride;
+		stats.indexBytes += (size_t)pool.indices.capacity * sizeof(GLuint);
+		stats.meshes += pool.meshes;
+	}
+
+	stats.pools = pools.size();
+
+	return stats;
+}
+
+void GeometryArena::clear() {
+	// deleting a bound vertex array unbinds it, which the state cache would not see
+	glState.bindVertexArray(0);
+
+	for (unsigned int i = 0; i < pools.size(); i++) {
+		glDeleteVertexArrays(1, &pools[i]->vertexArray);
+		glDeleteBuffers(1, &pools[i]->vertexBuffer);
+		glDeleteBuffers(1, &pools[i]->indexBuffer);
+		delete pools[i];
+	}
+
+	pools.clear();
+}
+
+
+// finds the pool for a vertex format, creating it on first use
+GeometryPool* GeometryArena::getPool(const VertexFormat& format, UploadStats& uploadStats) {
+	for (unsigned int i = 0; i < pools.size(); i++) {
+		if (sameVertexFormat(pools[i]->format, format))
+			return pools[i];
+	}
+
+	GeometryPool* pool = new GeometryPool();
+	pool->format = format;
+
+	growBuffer(pool->vertexBuffer, 0, (size_t)INITIAL_POOL_VERTICES * format.stride, uploadStats);
+	growBuffer(pool->indexBuffer, 0, (size_t)INITIAL_POOL_INDICES * sizeof(GLuint), uploadStats);
+	pool->vertices.grow(INITIAL_POOL_VERTICES);
+	pool->indices.grow(INITIAL_POOL_INDICES);
+
+	glGenVertexArrays(1, &pool->vertexArray);
+	uploadStats.glCalls++;
+	setupVertexArray(*pool, uploadStats);
+
+	pools.push_back(pool);
+
+	return pool;
+}
+
+// replaces a buffer with a larger one, keeping its contents
+void GeometryArena::growBuffer(GLuint& buffer, size_t oldBytes, size_t newBytes, UploadStats& uploadStats) {
+	GLuint newBuffer = 0;
+
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+	uploadStats.bufferAllocations++;
+	uploadStats.glCalls += 3;
+
+	if (buffer) {
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+		uploadStats.glCalls += 4;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	uploadStats.glCalls++;
+
+	buffer = newBuffer;
+}
+
+void GeometryArena::setupVertexArray(GeometryPool& pool, UploadStats& uploadStats) {
+	glState.bindVertexArray(pool.vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer);
+	uploadStats.glCalls += 2;
+
+	for (unsigned int i = 0; i < NUM_VERTEX_BUFFERS; i++) {
+		const VertexAttribute& attribute = pool.format.attributes[i];
+		if (!attribute.enabled)
+			continue;
+
+		glVertexAttribPointer(i, attribute.size, attribute.type, attribute.normalised, pool.format.stride, (void*)attribute.offset);
+		glEnableVertexAttribArray(i);
+		uploadStats.glCalls += 2;
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.indexBuffer);
+
+	glState.bindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	uploadStats.glCalls += 3;
+}
+
+
+bool sameVertexFormat(const VertexFormat& a, const VertexFormat& b) {
+	if (a.layout != b.layout || a.stride != b.stride)
+		return false;
+
+	for (unsigned int i = 0; i < NUM_VERTEX_BUFFERS; i++) {
+		const VertexAttribute& x = a.attributes[i];
+		const VertexAttribute& y = b.attributes[i];
+
+		if (x.enabled != y.enabled)
+			return false;
+
+		if (x.enabled && (x.size != y.size || x.type != y.type || x.normalised != y.normalised || x.offset != y.offset))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,97 @@
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H
+
+#include <map>
+#include <vector>
+#include <GL/glew.h>
+
+#include "MeshUploader.h"
+#include "VertexFormat.h"
+
+
+///////////////////////////////////////////////////
+// Geometry Arena
+// Interleaved meshes are sub-allocated from a few large pools instead of a
+// buffer per model. Each pool holds one vertex format, with a vertex buffer,
+// a 32-bit index buffer and a single vertex array, so every mesh in a pool can
+// be drawn by one glMultiDrawElementsIndirect call. Pools double in size
+// (copied on the GPU) when they run out of space.
+
+// Layout of one glMultiDrawElementsIndirect command
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// First fit allocator over a range of elements, freed ranges are merged with their neighbours
+class RangeAllocator {
+public:
+	unsigned int capacity = 0;
+
+	// returns false when no free range is large enough
+	bool allocate(unsigned int count, unsigned int& offset);
+	void free(unsigned int offset, unsigned int count);
+
+	// adds the elements between capacity and newCapacity to the free ranges
+	void grow(unsigned int newCapacity);
+private:
+	std::map<unsigned int, unsigned int> freeRanges; // offset -> count
+};
+
+struct GeometryPool {
+	VertexFormat format;
+	GLuint vertexArray = 0;
+	GLuint vertexBuffer = 0;
+	GLuint indexBuffer = 0;
+	RangeAllocator vertices;	// in vertices of format.stride bytes
+	RangeAllocator indices;		// in 32-bit indices
+	unsigned int meshes = 0;
+};
+
+// Where a mesh lives within the arena (pool is NULL when it is not in the arena)
+struct ArenaAllocation {
+	GeometryPool* pool = NULL;
+	GLint baseVertex = 0;
+	unsigned int vertexCount = 0;
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+};
+
+struct ArenaStats {
+	size_t vertexBytes = 0;		// capacity of every pool
+	size_t indexBytes = 0;
+	unsigned int pools = 0;
+	unsigned int meshes = 0;
+};
+
+
+class GeometryArena {
+public:
+	// multi-draw indirect, storage buffers and gl_DrawID (GL 4.3 + GL_ARB_shader_draw_parameters)
+	bool isSupported();
+
+	// copies interleaved vertices and their indices into the pool for the format
+	bool allocate(const VertexFormat& format, const void* vertices, unsigned int vertexCount, const std::vector<unsigned int>& indices, ArenaAllocation& allocation, UploadStats& uploadStats);
+	void free(ArenaAllocation& allocation);
+
+	ArenaStats getStats() const;
+
+	// deletes every pool (call before the context is destroyed)
+	void clear();
+private:
+	std::vector<GeometryPool*> pools;
+	int supported = -1;
+
+	GeometryPool* getPool(const VertexFormat& format, UploadStats& uploadStats);
+	void growBuffer(GLuint& buffer, size_t oldBytes, size_t newBytes, UploadStats& uploadStats);
+	void setupVertexArray(GeometryPool& pool, UploadStats& uploadStats);
+};
+
+bool sameVertexFormat(const VertexFormat& a, const VertexFormat& b);
+
+extern GeometryArena geometryArena;
+
+#endif
@@ -0,0 +1,135 @@
+#include "Hash.h"
+#include "FileUtils.h"
+
+#include <cstring>
+
+
+///////////////////////////////////////////////////
+// XXH64 constants
+const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+
+static inline uint64_t rotl64(uint64_t value, int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t read64(const unsigned char* ptr) {
+	uint64_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+static inline uint32_t read32(const unsigned char* ptr) {
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+	acc *= PRIME64_1;
+	return acc;
+}
+
+static inline uint64_t mergeRound64(uint64_t acc, uint64_t value) {
+	value = round64(0, value);
+	acc ^= value;
+	acc = acc * PRIME64_1 + PRIME64_4;
+	return acc;
+}
+
+
+uint64_t hashBytes(const void* data, size_t length, uint64_t seed) {
+	const unsigned char* ptr = (const unsigned char*)data;
+	const unsigned char* end = ptr + length;
+	uint64_t hash;
+
+	if (length >= 32) {
+		// process 32 byte stripes over 4 accumulators
+		const unsigned char* limit = end - 32;
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+
+		do {
+			v1 = round64(v1, read64(ptr)); ptr += 8;
+			v2 = round64(v2, read64(ptr)); ptr += 8;
+			v3 = round64(v3, read64(ptr)); ptr += 8;
+			v4 = round64(v4, read64(ptr)); ptr += 8;
+		} while (ptr <= limit);
+
+		hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+		hash = mergeRound64(hash, v1);
+		hash = mergeRound64(hash, v2);
+		hash = mergeRound64(hash, v3);
+		hash = mergeRound64(hash, v4);
+	}
+	else {
+		hash = seed + PRIME64_5;
+	}
+
+	hash += (uint64_t)length;
+
+	// process the remaining tail
+	while (ptr + 8 <= end) {
+		hash ^= round64(0, read64(ptr));
+		hash = rotl64(hash, 27) * PRIME64_1 + PRIME64_4;
+		ptr += 8;
+	}
+
+	if (ptr + 4 <= end) {
+		hash ^= (uint64_t)read32(ptr) * PRIME64_1;
+		hash = rotl64(hash, 23) * PRIME64_2 + PRIME64_3;
+		ptr += 4;
+	}
+
+	while (ptr < end) {
+		hash ^= (*ptr) * PRIME64_5;
+		hash = rotl64(hash, 11) * PRIME64_1;
+		ptr++;
+	}
+
+	// final avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+uint64_t hashString(const std::string& value, uint64_t seed) {
+	return hashBytes(value.data(), value.size(), seed);
+}
+
+uint64_t hashFile(const std::string& path, uint64_t seed) {
+	std::vector<char> contents;
+
+	if (!readFileBytes(path, contents))
+		return 0;
+
+	return hashBytes(contents.data(), contents.size(), seed);
+}
+
+uint64_t hashCombine(uint64_t hash, uint64_t value) {
+	return hashBytes(&value, sizeof(value), hash);
+}
+
+std::string hashToHex(uint64_t hash) {
+	const char* digits = "0123456789abcdef";
+	std::string hex(16, '0');
+
+	for (int i = 15; i >= 0; i--) {
+		hex[i] = digits[hash & 0xF];
+		hash >>= 4;
+	}
+
+	return hex;
+}
@@ -0,0 +1,22 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+///////////////////////////////////////////////////
+// 64-bit xxHash (XXH64) implementation, used to key the import and shader caches
+uint64_t hashBytes(const void* data, size_t length, uint64_t seed = 0);
+uint64_t hashString(const std::string& value, uint64_t seed = 0);
+
+// hashes the contents of a file, returns 0 if the file cannot be read
+uint64_t hashFile(const std::string& path, uint64_t seed = 0);
+
+// combines two hashes (order dependent)
+uint64_t hashCombine(uint64_t hash, uint64_t value);
+
+std::string hashToHex(uint64_t hash);
+
+#endif
@@ -0,0 +1,322 @@
+#include "IndexOptimizer.h"
+
+#include <climits>
+#include <algorithm>
+#include <unordered_map>
+
+
+///////////////////////////////////////////////////
+// DataTypes
+// Contiguous triangles moved as one by the overdraw pass
+struct IndexCluster {
+	unsigned int firstIndex;
+	unsigned int count;
+	unsigned int meshlet;	// UINT_MAX when the mesh has no meshlets
+	float sortKey;			// how far the cluster faces out from the mesh centre
+};
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+void tipsify(const unsigned int* indices, size_t count, unsigned int* output, std::vector<unsigned int>* clusterStarts);
+void sortClusters(VecData& vecData, std::vector<IndexCluster>& clusters, std::vector<Meshlet>& meshlets);
+void optimizeVertexFetch(VecData& vecData);
+
+
+void optimizeIndexOrder(VecData& vecData, std::vector<Meshlet>& meshlets) {
+	if (vecData.indices.size() < 3)
+		return;
+
+	std::vector<unsigned int> reordered(vecData.indices.size());
+	std::vector<IndexCluster> clusters;
+
+	///////////////////////////////////////////////////
+	// Vertex cache order within each meshlet, or over the whole mesh (split where the fans jump)
+	if (!meshlets.empty()) {
+		for (unsigned int i = 0; i < meshlets.size(); i++) {
+			const Meshlet& meshlet = meshlets[i];
+			tipsify(&vecData.indices[meshlet.firstIndex], meshlet.triangleCount * 3, &reordered[meshlet.firstIndex], NULL);
+
+			IndexCluster cluster;
+			cluster.firstIndex = meshlet.firstIndex;
+			cluster.count = meshlet.triangleCount * 3;
+			cluster.meshlet = i;
+			clusters.push_back(cluster);
+		}
+	}
+	else {
+		std::vector<unsigned int> clusterStarts;
+		tipsify(&vecData.indices[0], vecData.indices.size(), &reordered[0], &clusterStarts);
+
+		for (unsigned int i = 0; i < clusterStarts.size(); i++) {
+			unsigned int end = i + 1 < clusterStarts.size() ? clusterStarts[i + 1] : (unsigned int)(vecData.indices.size() / 3);
+
+			IndexCluster cluster;
+			cluster.firstIndex = clusterStarts[i] * 3;
+			cluster.count = (end - clusterStarts[i]) * 3;
+			cluster.meshlet = UINT_MAX;
+			clusters.push_back(cluster);
+		}
+	}
+
+	vecData.indices = reordered;
+
+	sortClusters(vecData, clusters, meshlets);
+	optimizeVertexFetch(vecData);
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices) {
+	if (indices.size() < 3)
+		return;
+
+	std::vector<unsigned int> reordered(indices.size());
+	tipsify(&indices[0], indices.size(), &reordered[0], NULL);
+	indices = reordered;
+}
+
+VertexCacheStats measureVertexCache(const std::vector<unsigned int>& indices) {
+	VertexCacheStats stats;
+	if (indices.empty())
+		return stats;
+
+	// a vertex is cached while fewer than VERTEX_CACHE_SIZE misses followed its own
+	std::vector<size_t> missTime(*std::max_element(indices.begin(), indices.end()) + 1, 0);
+	size_t time = VERTEX_CACHE_SIZE + 1;
+
+	for (unsigned int index : indices) {
+		if (missTime[index] == 0)
+			stats.vertices++;
+
+		if (time - missTime[index] > VERTEX_CACHE_SIZE) {
+			missTime[index] = time++;
+			stats.misses++;
+		}
+	}
+
+	stats.triangles = indices.size() / 3;
+
+	return stats;
+}
+
+
+// Tipsify (Sander, Nehab and Barczak 2007): emits every triangle around a fanning vertex, then moves on to
+// the vertex of that fan which will still be cached once its own triangles are emitted (the oldest such one).
+// clusterStarts receives the first triangle after each jump out of the last fan.
+void tipsify(const unsigned int* indices, size_t count, unsigned int* output, std::vector<unsigned int>* clusterStarts) {
+	size_t numTriangles = count / 3;
+
+	///////////////////////////////////////////////////
+	// Compact vertex ids, so a meshlet only pays for its own vertices
+	std::unordered_map<unsigned int, unsigned int> localIds;
+	std::vector<unsigned int> corners(count);
+
+	for (size_t i = 0; i < count; i++)
+		corners[i] = localIds.insert(std::make_pair(indices[i], (unsigned int)localIds.size())).first->second;
+
+	size_t numVertices = localIds.size();
+
+	// triangles around each vertex
+	std::vector<unsigned int> triangleOffsets(numVertices + 1, 0);
+	std::vector<unsigned int> triangleLists(count);
+
+	for (size_t i = 0; i < count; i++)
+		triangleOffsets[corners[i] + 1]++;
+
+	for (size_t i = 1; i <= numVertices; i++)
+		triangleOffsets[i] += triangleOffsets[i - 1];
+
+	std::vector<unsigned int> liveTriangles(numVertices, 0);
+	for (size_t i = 0; i < count; i++) {
+		unsigned int vertex = corners[i];
+		triangleLists[triangleOffsets[vertex] + liveTriangles[vertex]++] = (unsigned int)(i / 3);
+	}
+
+	///////////////////////////////////////////////////
+	// Fan around one vertex after another
+	std::vector<unsigned int> cacheTime(numVertices, 0);
+	std::vector<unsigned int> deadEnds;
+	std::vector<unsigned int> candidates;
+	std::vector<bool> emitted(numTriangles, false);
+
+	unsigned int time = VERTEX_CACHE_SIZE + 1;
+	unsigned int cursor = 0;	// vertices before it have no triangles left
+	unsigned int fan = 0;
+	size_t written = 0;
+	bool jumped = true;
+
+	while (fan != UINT_MAX) {
+		candidates.clear();
+
+		for (unsigned int j = triangleOffsets[fan]; j < triangleOffsets[fan + 1]; j++) {
+			unsigned int triangle = triangleLists[j];
+			if (emitted[triangle])
+				continue;
+
+			if (jumped && clusterStarts)
+				clusterStarts->push_back((unsigned int)(written / 3));
+			jumped = false;
+
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int vertex = corners[triangle * 3 + k];
+				output[written++] = indices[triangle * 3 + k];
+
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+
+				if (time - cacheTime[vertex] > VERTEX_CACHE_SIZE)
+					cacheTime[vertex] = time++;
+			}
+
+			emitted[triangle] = true;
+		}
+
+		// the oldest candidate that stays cached while its remaining triangles add up to two vertices each
+		unsigned int next = UINT_MAX;
+		int bestPriority = -1;
+
+		for (unsigned int vertex : candidates) {
+			if (liveTriangles[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= VERTEX_CACHE_SIZE)
+				priority = time - cacheTime[vertex];
+
+			if (priority > bestPriority) {
+				next = vertex;
+				bestPriority = priority;
+			}
+		}
+
+		// dead end: back to the most recent vertex with triangles left, then to the first one anywhere
+		if (next == UINT_MAX) {
+			jumped = true;
+
+			while (!deadEnds.empty() && next == UINT_MAX) {
+				unsigned int vertex = deadEnds.back();
+				deadEnds.pop_back();
+
+				if (liveTriangles[vertex] > 0)
+					next = vertex;
+			}
+
+			while (next == UINT_MAX && cursor < numVertices) {
+				if (liveTriangles[cursor] > 0)
+					next = cursor;
+				else
+					cursor++;
+			}
+		}
+
+		fan = next;
+	}
+}
+
+// Outward facing clusters first (Sander et al.): sorted by how far the cluster centre lies in front of
+// the mesh centre along the cluster's facing. Facings follow the vertex normals, whatever the winding.
+void sortClusters(VecData& vecData, std::vector<IndexCluster>& clusters, std::vector<Meshlet>& meshlets) {
+	if (clusters.size() < 2)
+		return;
+
+	bool hasNormals = vecData.normals.size() == vecData.vertices.size();
+
+	std::vector<glm::vec3> clusterCentres(clusters.size(), glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterFacings(clusters.size(), glm::vec3(0.0f));
+	glm::vec3 meshCentre = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+
+	for (unsigned int c = 0; c < clusters.size(); c++) {
+		float clusterArea = 0.0f;
+
+		for (unsigned int i = clusters[c].firstIndex; i < clusters[c].firstIndex + clusters[c].count; i += 3) {
+			unsigned int a = vecData.indices[i], b = vecData.indices[i + 1], d = vecData.indices[i + 2];
+			glm::vec3 facing = glm::cross(vecData.vertices[b] - vecData.vertices[a], vecData.vertices[d] - vecData.vertices[a]);
+			float area = glm::length(facing) * 0.5f;
+			glm::vec3 centre = (vecData.vertices[a] + vecData.vertices[b] + vecData.vertices[d]) / 3.0f;
+
+			if (hasNormals && glm::dot(facing, vecData.normals[a] + vecData.normals[b] + vecData.normals[d]) < 0.0f)
+				facing = -facing;
+
+			clusterCentres[c] += centre * area;
+			clusterFacings[c] += facing;
+			clusterArea += area;
+		}
+
+		meshCentre += clusterCentres[c];
+		meshArea += clusterArea;
+
+		if (clusterArea > 0.0f)
+			clusterCentres[c] /= clusterArea;
+	}
+
+	if (meshArea == 0.0f)
+		return;
+
+	meshCentre /= meshArea;
+
+	for (unsigned int c = 0; c < clusters.size(); c++) {
+		float length = glm::length(clusterFacings[c]);
+		clusters[c].sortKey = length > 0.0f ? glm::dot(clusterCentres[c] - meshCentre, clusterFacings[c] / length) : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const IndexCluster& a, const IndexCluster& b) { return a.sortKey > b.sortKey; });
+
+	///////////////////////////////////////////////////
+	// Copy the clusters out in their new order, meshlets follow their triangles
+	std::vector<unsigned int> indices;
+	std::vector<Meshlet> sortedMeshlets;
+	indices.reserve(vecData.indices.size());
+
+	for (const IndexCluster& cluster : clusters) {
+		if (cluster.meshlet != UINT_MAX) {
+			Meshlet meshlet = meshlets[cluster.meshlet];
+			meshlet.firstIndex = (unsigned int)indices.size();
+			sortedMeshlets.push_back(meshlet);
+		}
+
+		indices.insert(indices.end(), vecData.indices.begin() + cluster.firstIndex, vecData.indices.begin() + cluster.firstIndex + cluster.count);
+	}
+
+	vecData.indices = indices;
+	if (!meshlets.empty())
+		meshlets = sortedMeshlets;
+}
+
+// renumbers the vertices in order of first use (vertices no triangle uses are dropped)
+void optimizeVertexFetch(VecData& vecData) {
+	size_t numVertices = vecData.vertices.size();
+	bool hasNormals = vecData.normals.size() == numVertices;
+	bool hasUvs = vecData.uvs.size() == numVertices;
+
+	std::vector<unsigned int> remap(numVertices, UINT_MAX);
+	unsigned int numUsed = 0;
+
+	for (unsigned int& index : vecData.indices) {
+		if (remap[index] == UINT_MAX)
+			remap[index] = numUsed++;
+		index = remap[index];
+	}
+
+	VecData reordered;
+	reordered.materialName = vecData.materialName;
+	reordered.vertices.resize(numUsed);
+	if (hasNormals)
+		reordered.normals.resize(numUsed);
+	if (hasUvs)
+		reordered.uvs.resize(numUsed);
+
+	for (size_t i = 0; i < numVertices; i++) {
+		if (remap[i] == UINT_MAX)
+			continue;
+
+		reordered.vertices[remap[i]] = vecData.vertices[i];
+		if (hasNormals)
+			reordered.normals[remap[i]] = vecData.normals[i];
+		if (hasUvs)
+			reordered.uvs[remap[i]] = vecData.uvs[i];
+	}
+
+	reordered.indices.swap(vecData.indices);
+	vecData = reordered;
+}
@@ -0,0 +1,31 @@
+#ifndef INDEXOPTIMIZER_H
+#define INDEXOPTIMIZER_H
+
+#include "Mesh.h"
+
+
+///////////////////////////////////////////////////
+// Index Optimizer
+// Import time reordering of an indexed mesh for the GPU, none of which
+// changes what is drawn:
+//   - vertex cache: the triangles are emitted as fans around recently used
+//     vertices (Tipsify), so most corners hit the post-transform cache
+//   - overdraw: runs of neighbouring triangles (the meshlets, when the mesh
+//     has them) are drawn outward facing first, so the depth test rejects
+//     more of the fragments behind them
+//   - vertex fetch: vertices are stored in the order they are first used
+// Triangles never leave their meshlet, so the meshlet ranges and bounds stay valid.
+
+// size of the FIFO cache the order is optimised for and measured with
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// runs the three passes over level 0 (call before the levels of detail are generated, vertices are renumbered)
+void optimizeIndexOrder(VecData& vecData, std::vector<Meshlet>& meshlets);
+
+// reorders a triangle list for the vertex cache only
+void optimizeVertexCache(std::vector<unsigned int>& indices);
+
+// simulates the FIFO vertex cache over a triangle list
+VertexCacheStats measureVertexCache(const std::vector<unsigned int>& indices);
+
+#endif
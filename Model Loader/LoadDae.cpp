@@ -6,7 +6,7 @@ void addMeshToModel(Model& model, std::vector<VecData> daeVec, std::vector<MtlDa
 void splitIntoVector(std::vector<glm::vec2>& targetVector, std::string values);
 void splitIntoVector(std::vector<glm::vec3>& targetVector, std::string values);
 void splitIntoVector(std::vector<glm::vec4>& targetVector, std::string values);
-void processDaeData(
+bool processDaeData(
 	std::string modelPath,
 	VecData& vecData,
 	std::vector<glm::vec2> tmpUvs,
@@ -15,12 +15,12 @@ void processDaeData(
 	std::vector<unsigned int> uvIndices,
 	std::vector<unsigned int> positionIndices,
 	std::vector<unsigned int> normalIndices);
-std::vector<Texture> processTextures(std::string path, std::string texturePath);
 bool coloursAreDifferent(glm::vec4 colour1, glm::vec4 colour2);
+bool daeIndicesInRange(const std::vector<unsigned int>& indices, size_t count);
 
 
 
-void loadDae(Model& model) {
+bool loadDae(Model& model) {
 	///////////////////////////////////////////////////
 	// 1. Read file
 	std::string line;
@@ -153,6 +153,13 @@ void loadDae(Model& model) {
 				}
 			}
 			else if (line.find("<p>") != npos && readIndices) {
+				if (indexNames.size() < 3) {
+					std::cout << std::endl;
+					std::cout << "ERROR->" << __FUNCTION__ << ": Unable to process dae file, triangles need vertex, normal and uv inputs" << std::endl;
+					std::cout << "More Info: " << model.path << " has " << indexNames.size() << " inputs" << std::endl;
+					return false;
+				}
+
 				// process index values
 				int start = line.find_first_of(">") + 1;
 				int end = line.find_last_of("<");
@@ -223,8 +230,9 @@ void loadDae(Model& model) {
 			}
 			else if (endOfDaeData) {
 				// create a DaeData object
-				processDaeData(model.path, tempDaeData, tmpUvs, tmpVertices, tmpNormals,
-					uvIndices, vertexIndices, normalIndices);
+				if (!processDaeData(model.path, tempDaeData, tmpUvs, tmpVertices, tmpNormals,
+					uvIndices, vertexIndices, normalIndices))
+					return false;
 
 				daeVector.push_back(tempDaeData);
 
@@ -246,7 +254,10 @@ void loadDae(Model& model) {
 	else {
 		std::cout << std::endl;
 		std::cout << "ERROR->" << __FUNCTION__ << ": Unable to open dae file, the file may not exist or be corrupt" << std::endl;
+		return false;
 	}
+
+	return true;
 }
 
 
@@ -259,12 +270,11 @@ void addMeshToModel(Model& model, std::vector<VecData> daeVector, std::vector<Mt
 
 				tempMesh.meshType = MeshType::DAE;
 				tempMesh.path = model.path.substr(0, model.path.find_last_of("\\/"));
-				tempMesh.textures = processTextures(tempMesh.path, texturePath);
 				
 				tempMesh.vecData = daeVector[vertIndex];
 				tempMesh.mtlData = mtlVec[matIndex];
+				tempMesh.mtlData.map_Kd = texturePath; // dae files share a single texture
 
-				tempMesh.setupMesh(model.shader);
 				model.meshes.push_back(tempMesh);
 			}
 		}
@@ -356,7 +366,7 @@ void splitIntoVector(std::vector<glm::vec4>& targetVector, std::string values) {
 	}
 }
 
-void processDaeData(
+bool processDaeData(
 	std::string modelPath,
 	VecData& vecData,
 	std::vector<glm::vec2> tmpUvs,
@@ -366,16 +376,13 @@ void processDaeData(
 	std::vector<unsigned int> vertexIndices,  
 	std::vector<unsigned int> normalIndices)
 {
-	int highestVertexIndex = *std::max_element(vertexIndices.begin(), vertexIndices.end());
-	int highestUvIndex = *std::max_element(uvIndices.begin(), uvIndices.end());
-	int highestNormalIndex = *std::max_element(normalIndices.begin(), normalIndices.end());
-
-	if (highestVertexIndex > tmpVertices.size() || highestUvIndex > tmpUvs.size() || highestNormalIndex > tmpNormals.size()) {
+	// uvs are optional (e.g. vertex coloured files), an empty index list is always in range
+	if (!daeIndicesInRange(vertexIndices, tmpVertices.size()) || !daeIndicesInRange(uvIndices, tmpUvs.size()) || !daeIndicesInRange(normalIndices, tmpNormals.size())) {
 		// something doesn't add up.. probably a corrupt file
 		std::cout << std::endl;
-		std::cout << "ERROR->" << __FUNCTION__ << ": Unable to process obj file, the file may be corrupt" << std::endl;
+		std::cout << "ERROR->" << __FUNCTION__ << ": Unable to process dae file, the file may be corrupt" << std::endl;
 		std::cout << "More Info: " << modelPath << " is missing vertices that are required by the files indices" << std::endl;
-		exit(EXIT_FAILURE);
+		return false;
 	}
 
 	for (int i = 0; i < uvIndices.size(); i++) {
@@ -394,6 +401,18 @@ void processDaeData(
 		unsigned int normalIndex = normalIndices[i];
 		vecData.normals.push_back(tmpNormals[normalIndex]);
 	}
+
+	return true;
+}
+
+// dae indices start at 0
+bool daeIndicesInRange(const std::vector<unsigned int>& indices, size_t count) {
+	for (unsigned int i = 0; i < indices.size(); i++) {
+		if (indices[i] >= count)
+			return false;
+	}
+
+	return true;
 }
 
 std::vector<Texture> processTextures(std::string path, std::string texturePath) {
@@ -424,8 +443,8 @@ std::vector<Texture> processTextures(std::string path, std::string texturePath)
 			glGenerateMipmap(GL_TEXTURE_2D);
 
 			Texture texture;
-			texture.id = 1;
-			texture.type = "texture_map";
+			texture.id = textureBuffer[0];
+			texture.type = "texture_diffuse";
 
 			textures.push_back(texture);
 		}
@@ -7,6 +7,9 @@
 #include "stb_image.h"
 #include "Model.h";
 
-void loadDae(Model& model);
+// returns false (and leaves the model incomplete) if the file can't be read or is corrupt
+bool loadDae(Model& model);
+
+std::vector<Texture> processTextures(std::string path, std::string texturePath);
 
 #endif
\ No newline at end of file
@@ -28,10 +28,10 @@ VecData processObjectData(
 
 MtlData processMaterialData(std::string path, std::string currMaterialName);
 
-std::vector<Texture> processTextures(MtlData mtlData, std::string path);
+bool objIndicesInRange(const std::vector<unsigned int>& indices, size_t count);
 
 
-void loadObj(Model& model)
+bool loadObj(Model& model)
 {
 	std::vector<glm::vec3> tmpVertices;
 	std::vector<glm::vec2> tmpUvs;
@@ -106,6 +106,13 @@ void loadObj(Model& model)
 						faceElements.push_back(token);
 					}
 
+					if (faceElements.size() < 3) {
+						std::cout << std::endl;
+						std::cout << "ERROR->" << __FUNCTION__ << ": Unable to process obj file, faces need vertex/uv/normal indices" << std::endl;
+						std::cout << "More Info: " << model.path << " has the face '" << line << "'" << std::endl;
+						return false;
+					}
+
 					tmpVertIndices.push_back(std::stoi(faceElements[0]));
 					tmpUvIndices.push_back(std::stoi(faceElements[1]));
 					tmpNormalIndices.push_back(std::stoi(faceElements[2]));
@@ -135,16 +142,12 @@ void loadObj(Model& model)
 			if (objDataType == "f") {
 				if (linePeek.find("usemtl") != -1 || linePeek.find("o ") != -1 || linePeek.empty()) {
 					// must be at the next mesh or at EOF -> create a new mesh with the stored data
-					int highestVertexIndex = *std::max_element(vertexIndices.begin(), vertexIndices.end());
-					int highestUvIndex = *std::max_element(uvIndices.begin(), uvIndices.end());
-					int highestNormalIndex = *std::max_element(normalIndices.begin(), normalIndices.end());
-
-					if (highestVertexIndex > tmpVertices.size() || highestUvIndex > tmpUvs.size() || highestNormalIndex > tmpNormals.size()) {
+					if (!objIndicesInRange(vertexIndices, tmpVertices.size()) || !objIndicesInRange(uvIndices, tmpUvs.size()) || !objIndicesInRange(normalIndices, tmpNormals.size())) {
 						// something doesn't add up.. probably a corrupt file
 						std::cout << std::endl;
 						std::cout << "ERROR->" << __FUNCTION__ << ": Unable to process obj file, the file may be corrupt" << std::endl;
 						std::cout << "More Info: " << model.path << " is missing vertices that are required by the files indices" << std::endl;
-						exit(EXIT_FAILURE);
+						return false;
 					}
 
 					addMeshToCollection(model, tmpVertices, tmpUvs, tmpNormals, vertexIndices, uvIndices, normalIndices, model.path, currMaterialName);
@@ -155,11 +158,23 @@ void loadObj(Model& model)
 	else {
 	std::cout << std::endl;
 	std::cout << "ERROR->" << __FUNCTION__ << ": Unable to open obj file, the file may not exist or be corrupt" << std::endl;
+	return false;
 	}
 
 	///////////////////////////////////////////////////
 	// 5. Deallocate resources
 
+	return true;
+}
+
+// obj indices start at 1
+bool objIndicesInRange(const std::vector<unsigned int>& indices, size_t count) {
+	for (unsigned int i = 0; i < indices.size(); i++) {
+		if (indices[i] < 1 || indices[i] > count)
+			return false;
+	}
+
+	return true;
 }
 
 
@@ -178,9 +193,8 @@ void addMeshToCollection(Model& model,
 	tempMesh.path = path.substr(0, path.find_last_of("\\/"));
 	tempMesh.vecData = processObjectData(tmpVertices, tmpUvs, tmpNormals, vertexIndices, uvIndices, normalIndices);
 	tempMesh.mtlData = processMaterialData(path, currMaterialName);
-	tempMesh.textures = processTextures(tempMesh.mtlData, tempMesh.path);
 
-	tempMesh.setupMesh(model.shader);
+	// textures and buffers are created in Model::setupMeshes (so cached models can skip parsing)
 	model.meshes.push_back(tempMesh);	
 }
 
@@ -266,6 +280,7 @@ MtlData processMaterialData(std::string path, std::string currMaterialName) {
 					sstr >> mtlData.Kd.x;
 					sstr >> mtlData.Kd.y;
 					sstr >> mtlData.Kd.z;
+					mtlData.Kd.w = 1.0f; // opacity comes from d
 				}
 				else if (mtlDataType == "Ks") {
 					std::istringstream sstr(line.substr(3));
@@ -345,7 +360,7 @@ std::vector<Texture> processTextures(MtlData mtlData, std::string path) {
 				glGenerateMipmap(GL_TEXTURE_2D);
 
 				Texture texture;
-				texture.id = i;
+				texture.id = textureBuffers[i];
 				texture.type = textureTypes[i];
 
 				textures.push_back(texture);
@@ -22,7 +22,10 @@ const std::vector<std::string> textureTypes = {
 const int numTextureTypes = 3;
 
 
-void loadObj(Model& model);
+// returns false (and leaves the model incomplete) if the file can't be read or is corrupt
+bool loadObj(Model& model);
+
+std::vector<Texture> processTextures(MtlData mtlData, std::string path);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "LodSelector.h"
+
+#include <cfloat>
+#include <algorithm>
+
+
+///////////////////////////////////////////////////
+// Global Vars
+const float COARSER_THRESHOLD = 0.75f; // fraction of the pixel threshold a coarser level must stay under to switch to it
+
+
+void LodSelector::begin(const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
+	stats = LodStats();
+	this->view = view;
+	frame++;
+
+	// projection[1][1] is cot(fov / 2), half the viewport height covers tan(fov / 2) at a distance of one
+	pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+}
+
+unsigned int LodSelector::select(const CullItem& item) {
+	const Mesh& mesh = *item.mesh;
+	unsigned int numLods = mesh.getLodCount();
+	unsigned int lod = 0;
+
+	if (enabled && numLods > 1) {
+		///////////////////////////////////////////////////
+		// Pixels per unit of object space error at the nearest point of the bounding sphere
+		const glm::mat4& transform = item.transform;
+		float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+		glm::vec4 centre = view * transform * glm::vec4(mesh.bounds.centre, 1.0f);
+		float distance = glm::length(glm::vec3(centre)) - mesh.bounds.radius * scale;
+
+		// inside the sphere the full mesh is always drawn
+		float pixelsPerError = distance > 0.0f ? scale * pixelsPerUnit / distance : FLT_MAX;
+
+		ItemKey key;
+		key.mesh = &mesh;
+		key.transform = transform;
+
+		// new entries start at the coarsest level and move finer to the first level under the threshold
+		auto found = entries.find(key);
+		if (found == entries.end()) {
+			LodEntry entry;
+			entry.lod = numLods - 1;
+			found = entries.insert(std::make_pair(key, entry)).first;
+		}
+
+		LodEntry& entry = found->second;
+		entry.lastSeen = frame;
+		lod = std::min(entry.lod, numLods - 1);
+
+		while (lod > 0 && mesh.getLodError(lod) * pixelsPerError > pixelThreshold)
+			lod--;
+
+		while (lod + 1 < numLods && mesh.getLodError(lod + 1) * pixelsPerError <= pixelThreshold * COARSER_THRESHOLD)
+			lod++;
+
+		entry.lod = lod;
+	}
+
+	stats.copies[lod]++;
+	stats.triangles += mesh.stats.lodTriangles[lod];
+	stats.fullTriangles += mesh.stats.lodTriangles[0];
+
+	return lod;
+}
+
+void LodSelector::end() {
+	for (auto it = entries.begin(); it != entries.end(); ) {
+		if (it->second.lastSeen != frame)
+			it = entries.erase(it);
+		else
+			it++;
+	}
+}
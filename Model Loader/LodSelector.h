@@ -0,0 +1,55 @@
+#ifndef LODSELECTOR_H
+#define LODSELECTOR_H
+
+#include <map>
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+
+
+///////////////////////////////////////////////////
+// LOD Selector
+// Picks the level of detail of each visible mesh copy. The object space error
+// of a level is scaled by the copy's transform and projected to pixels at the
+// distance of the nearest point of its bounding sphere. The coarsest level
+// whose error stays under the pixel threshold is drawn.
+// Copies keep their level between frames and only switch to a coarser level
+// once its error is well under the threshold (hysteresis), so a copy resting
+// near a switching distance does not flicker between two levels.
+
+struct LodEntry {
+	unsigned int lod = 0;
+	unsigned int lastSeen = 0; // entries not selected in a frame are dropped
+};
+
+// Counters for the last frame
+struct LodStats {
+	unsigned int copies[MAX_LODS] = {};	// copies drawn at each level
+	unsigned int triangles = 0;			// triangles of the selected levels
+	unsigned int fullTriangles = 0;		// triangles had every copy been drawn at level 0
+};
+
+
+class LodSelector {
+public:
+	LodStats stats;
+	bool enabled = true;
+	float pixelThreshold = 1.0f; // largest error in pixels a level may show
+
+	// viewportHeight in pixels
+	void begin(const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+
+	// level of detail to draw the item at
+	unsigned int select(const CullItem& item);
+
+	// drops the entries that were not selected this frame
+	void end();
+private:
+	std::map<ItemKey, LodEntry> entries;
+
+	glm::mat4 view = glm::mat4(1.0f);
+	float pixelsPerUnit = 1.0f; // pixels covered by one unit at a distance of one
+	unsigned int frame = 0;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "MaterialTable.h"
+#include "Hash.h"
+#include "Shader.h"
+
+#include <cstring>
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+GpuMaterial packMaterial(const MtlData& mtlData);
+
+
+///////////////////////////////////////////////////
+// Global Vars
+MaterialTable materialTable;
+
+
+unsigned int MaterialTable::add(const MtlData& mtlData) {
+	GpuMaterial material = packMaterial(mtlData);
+	uint64_t hash = hashBytes(&material, sizeof(GpuMaterial));
+
+	auto found = indices.find(hash);
+	if (found != indices.end() && memcmp(&materials[found->second], &material, sizeof(GpuMaterial)) == 0)
+		return found->second;
+
+	if (materials.size() >= MAX_MATERIALS) {
+		std::cout << "ERROR->" << __FUNCTION__ << ": more than " << MAX_MATERIALS << " materials, " << mtlData.materialName << " is drawn with the first" << std::endl;
+		return 0;
+	}
+
+	unsigned int index = (unsigned int)materials.size();
+	materials.push_back(material);
+	indices.insert(std::make_pair(hash, index));
+
+	return index;
+}
+
+void MaterialTable::bind() {
+	// sized for the whole array, so the block is always backed however few materials are loaded
+	if (buffer == 0) {
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * sizeof(GpuMaterial), NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	if (uploaded < materials.size()) {
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, uploaded * sizeof(GpuMaterial), (materials.size() - uploaded) * sizeof(GpuMaterial), &materials[uploaded]);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		uploaded = materials.size();
+	}
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, buffer);
+}
+
+void MaterialTable::release() {
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+
+	buffer = 0;
+	uploaded = 0;
+	materials.clear();
+	indices.clear();
+}
+
+
+// Ni (optical density) only matters for refraction, which nothing here draws
+GpuMaterial packMaterial(const MtlData& mtlData) {
+	GpuMaterial material;
+	material.ambient = glm::vec4(glm::vec3(mtlData.Ka), mtlData.Ns);
+	material.diffuse = mtlData.Kd;
+	material.specular = glm::vec4(glm::vec3(mtlData.Ks), (float)mtlData.illum);
+	material.emissive = glm::vec4(glm::vec3(mtlData.Ke), mtlData.d);
+
+	return material;
+}
@@ -0,0 +1,54 @@
+#ifndef MATERIALTABLE_H
+#define MATERIALTABLE_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+
+///////////////////////////////////////////////////
+// Material Table
+// Every distinct material of the loaded models, packed once at load time into
+// a std140 uniform block (Materials in shader.fs). Meshes keep an index into the
+// table, so a draw selects its material with one int (the draw data of a multi
+// draw, a uniform otherwise) instead of setting each material value.
+// Textures stay bound per mesh, the table only holds the constants.
+
+// size of the Materials array in shader.fs (64 bytes each, the 16KB every GL 3.1 driver guarantees)
+const unsigned int MAX_MATERIALS = 256;
+
+// std140 layout of MaterialData in shader.fs
+struct GpuMaterial {
+	glm::vec4 ambient;	// Ka, w = Ns (specular exponent)
+	glm::vec4 diffuse;	// Kd
+	glm::vec4 specular;	// Ks, w = illum (illumination model)
+	glm::vec4 emissive;	// Ke, w = d (dissolve)
+};
+
+
+class MaterialTable {
+public:
+	// index of the material, shared by every mesh with the same values
+	unsigned int add(const MtlData& mtlData);
+
+	// uploads materials added since the last call and binds the table at MATERIAL_BLOCK_BINDING (once per frame)
+	void bind();
+
+	// deletes the buffer (call before the context is destroyed)
+	void release();
+
+	size_t size() const { return materials.size(); }
+private:
+	std::vector<GpuMaterial> materials;
+	std::unordered_map<uint64_t, unsigned int> indices;	// hash of the packed material
+	GLuint buffer = 0;
+	size_t uploaded = 0;	// materials already in the buffer
+};
+
+extern MaterialTable materialTable;
+
+#endif
@@ -1,93 +1,501 @@
 #include "Mesh.h"
+#include "ShaderRegistry.h"
+#include "GLState.h"
+#include "IndexOptimizer.h"
+
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+template<typename T> void appendBytes(std::vector<unsigned char>& stream, const std::vector<T>& values);
+
+
+bool Mesh::texturesEnabled = true;
 
 
 Mesh::Mesh() {
 
 }
 
-void Mesh::draw(Shader shader) {
-	unsigned int diffueNr	= 1;
+void Mesh::draw(const glm::mat4& model) {
+	if (!prepareShader())
+		return;
+
+	shader->use();
+	setTransform(model);
+	bindTextures();
+	bindMaterial();
+	bindVertexArray();
+	drawGeometry();
+}
+
+// selects the variant for the current features, false while it is still compiling
+bool Mesh::prepareShader() {
+	// the variant changes when textures are toggled or the mesh is re-uploaded
+	unsigned int features = getShaderFeatures();
+	if (shader == NULL || features != shaderFeatures)
+		selectShader(features);
+
+	// deferred until the driver has finished compiling the variant
+	if (!shader->isReady())
+		return false;
+
+	if (!uniformsResolved)
+		resolveUniforms();
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////
+// Draw steps (the mesh program must be bound)
+void Mesh::setTransform(const glm::mat4& model) {
+	modelUniform.set(model);
+}
+
+void Mesh::bindTextures() {
+	// untextured variants sample nothing, so the textures are left unbound
+	unsigned int textureCount = (shaderFeatures & (SHADER_TEXTURED | SHADER_ALPHA_MAPPED)) ? textures.size() : 0;
+
+	for (unsigned int i = 0; i < textureCount; i++)	{
+		textureUniforms[i].set(i);
+		glState.bindTexture(i, textures[i].id);
+	}
+}
+
+// the material values live in the material table, only the index is set
+void Mesh::bindMaterial() {
+	materialUniform.set((int)materialIndex);
+}
+
+void Mesh::bindVertexArray() {
+	glState.bindVertexArray(VAO);
+}
+
+// points the instance transform attributes at a buffer of mat4s, only when they change
+void Mesh::bindInstanceBuffer(GLuint buffer, size_t offset) {
+	if (instanceBuffer == buffer && instanceOffset == offset)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	for (GLuint column = 0; column < 4; column++) {
+		GLuint location = INSTANCE_TRANSFORM_LOCATION + column;
+
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(location, 1);
+		glEnableVertexAttribArray(location);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	instanceBuffer = buffer;
+	instanceOffset = offset;
+}
+
+void Mesh::setDrawOffset(GLuint offset) {
+	drawOffsetUniform.set((int)offset);
+}
+
+void Mesh::drawGeometry(GLsizei instanceCount, GLuint baseInstance, unsigned int lod) {
+	positionScaleUniform.set(positionScale);
+	positionOffsetUniform.set(positionOffset);
+
+	GLsizei indexCount = 0;
+	void* indices = NULL;
+
+	if (indexed) {
+		const LodRange& range = lodRanges[std::min<size_t>(lod, lodRanges.size() - 1)];
+		indexCount = range.count;
+		indices = (void*)(indexOffset + range.firstIndex * (indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint)));
+	}
+
+	// base vertex is the start of the mesh within an arena pool (0 in a model buffer)
+	if (!instanced) {
+		if (indexed)
+			glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, indexType, indices, baseVertex);
+		else
+			glDrawArrays(GL_TRIANGLES, 0, vecData.vertices.size());
+	}
+	else if (baseInstance > 0) {
+		// base instance offsets the instance attributes into the buffer (GL 4.2)
+		if (indexed)
+			glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, indexCount, indexType, indices, instanceCount, baseVertex, baseInstance);
+		else
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, vecData.vertices.size(), instanceCount, baseInstance);
+	}
+	else {
+		if (indexed)
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount, indexType, indices, instanceCount, baseVertex);
+		else
+			glDrawArraysInstanced(GL_TRIANGLES, 0, vecData.vertices.size(), instanceCount);
+	}
+}
+
+DrawElementsIndirectCommand Mesh::getDrawCommand(GLuint instanceCount, GLuint baseInstance, unsigned int lod) const {
+	const LodRange& range = lodRanges[std::min<size_t>(lod, lodRanges.size() - 1)];
+
+	DrawElementsIndirectCommand command;
+	command.count = range.count;
+	command.instanceCount = instanceCount;
+	command.firstIndex = arena.firstIndex + range.firstIndex;
+	command.baseVertex = arena.baseVertex;
+	command.baseInstance = baseInstance;
+
+	return command;
+}
+
+MeshDrawData Mesh::getDrawData() const {
+	MeshDrawData data;
+	data.positionScale = glm::vec4(positionScale, 0.0f);
+	data.positionOffset = glm::vec4(positionOffset, 0.0f);
+	data.material = (GLint)materialIndex;
+	data.padding[0] = data.padding[1] = data.padding[2] = 0;
+
+	return data;
+}
+
+void Mesh::stageMesh(MeshUploader& uploader, bool useArena) {
+	stats = MeshStats();
+
+	stats.lodTriangles[0] = vecData.elementCount() / 3;
+	for (unsigned int i = 0; i < lods.size() && i + 1 < MAX_LODS; i++)
+		stats.lodTriangles[i + 1] = lods[i].indices.size() / 3;
+	stats.meshlets = meshlets.size();
+	stats.vertexCache = measureVertexCache(vecData.indices);
+
+	bool hasNormals = !vecData.normals.empty() && vecData.normals.size() == vecData.vertices.size();
+	bool hasUvs = !vecData.uvs.empty() && vecData.uvs.size() == vecData.vertices.size();
+
+	format = createVertexFormat(precision, layout, hasNormals, hasUvs, strideAlignment);
+
+	// tightly packed data for each attribute, in the format's element types
+	std::vector<unsigned char> streams[NUM_VERTEX_BUFFERS];
+
+	if (precision == VertexPrecision::QUANTIZED)
+		encodeQuantized(streams, hasNormals, hasUvs);
+	else
+		encodeFullPrecision(streams, hasNormals, hasUvs);
+
+
+	// vertex data
+	if (layout == VertexLayout::INTERLEAVED) {
+		std::vector<unsigned char> vertices = interleaveVertices(format, streams, vecData.vertices.size());
+
+		if (useArena && stageInArena(vertices, uploader.stats))
+			return;
+
+		size_t vertexOffset = vertices.empty() ? 0 : uploader.stage(vertices.data(), vertices.size());
+
+		for (unsigned int i = 0; i < NUM_VERTEX_BUFFERS; i++)
+			attributeOffsets[i] = vertexOffset + format.attributes[i].offset;
+
+		stats.vertexBytes = vertices.size();
+	}
+	else {
+		for (unsigned int i = 0; i < NUM_VERTEX_BUFFERS; i++) {
+			attributeOffsets[i] = 0;
+			if (!format.attributes[i].enabled || streams[i].empty())
+				continue;
+
+			attributeOffsets[i] = uploader.stage(streams[i].data(), streams[i].size());
+			stats.vertexBytes += streams[i].size();
+		}
+	}
+
+
+	// index data (16 bit indices are enough for most meshes)
+	indexed = !vecData.indices.empty();
+
+	if (indexed) {
+		std::vector<unsigned int> indices = appendLodIndices(vecData.indices);
+
+		if (vecData.vertices.size() <= 65536) {
+			std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+
+			indexType = GL_UNSIGNED_SHORT;
+			stats.indexBytes = shortIndices.size() * sizeof(unsigned short);
+			indexOffset = stats.indexBytes == 0 ? 0 : uploader.stage(shortIndices.data(), stats.indexBytes);
+		}
+		else {
+			indexType = GL_UNSIGNED_INT;
+			stats.indexBytes = indices.size() * sizeof(unsigned int);
+			indexOffset = stats.indexBytes == 0 ? 0 : uploader.stage(indices.data(), stats.indexBytes);
+		}
+	}
+}
+
+void Mesh::setupMesh(GLuint buffer, UploadStats& uploadStats) {
+	// the pool vertex array already points at the arena buffers
+	if (inArena()) {
+		VAO = arena.pool->vertexArray;
+		selectShader(getShaderFeatures());
+		return;
+	}
+
+	///////////////////////////////////////////////////////////
+	// Setup Vertex Array (all attributes live in the model buffer)
+	glGenVertexArrays(1, &VAO);
+	glState.bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	uploadStats.glCalls += 3;
+
+	for (unsigned int i = 0; i < NUM_VERTEX_BUFFERS; i++) {
+		VertexAttribute& attribute = format.attributes[i];
+		if (!attribute.enabled)
+			continue;
+
+		glVertexAttribPointer(i, attribute.size, attribute.type, attribute.normalised, getAttributeStride(format, i), (void*)attributeOffsets[i]);
+		glEnableVertexAttribArray(i);
+		uploadStats.glCalls += 2;
+	}
+
+	if (indexed) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+		uploadStats.glCalls++;
+	}
+
+	glState.bindVertexArray(0);
+
+	selectShader(getShaderFeatures());
+}
+
+void Mesh::releaseMesh() {
+	if (VAO == NULL)
+		return;
+
+	if (inArena()) {
+		// the ranges are returned to the pool, which keeps its buffers and vertex array
+		geometryArena.free(arena);
+		baseVertex = 0;
+	}
+	else {
+		// deleting a bound vertex array unbinds it, which the state cache would not see
+		glState.bindVertexArray(0);
+
+		// the buffer belongs to the model, only the vertex array is owned by the mesh
+		glDeleteVertexArrays(1, &VAO);
+	}
+
+	VAO = NULL;
+	instanceBuffer = 0;
+	instanceOffset = 0;
+}
+
+unsigned int Mesh::getShaderFeatures() const {
+	unsigned int features = 0;
+
+	if (texturesEnabled && format.attributes[TEXTURES].enabled) {
+		for (unsigned int i = 0; i < textures.size(); i++) {
+			if (textures[i].type == "texture_diffuse")
+				features |= SHADER_TEXTURED;
+			else if (textures[i].type == "texture_alpha")
+				features |= SHADER_ALPHA_MAPPED;
+		}
+	}
+
+	if (format.attributes[COLOUR].enabled)
+		features |= SHADER_VERTEX_COLOUR;
+
+	// illum 0 is a constant colour (MTL), so only lit materials pay for the lighting
+	if (format.attributes[NORMALS].enabled && mtlData.illum >= 1)
+		features |= SHADER_LIT;
+
+	if (precision == VertexPrecision::QUANTIZED)
+		features |= SHADER_QUANTIZED;
+
+	// meshes in the arena are drawn by multi draw commands, anything else by instanced draws
+	if (instanced)
+		features |= inArena() ? SHADER_MULTI_DRAW : SHADER_INSTANCED;
+
+	return features;
+}
+
+// binds the mesh to a shader variant, which is submitted for compiling on first use
+void Mesh::selectShader(unsigned int features) {
+	shader = shaderRegistry.requestVariant(features);
+	shaderFeatures = features;
+	uniformsResolved = false;
+}
+
+void Mesh::resolveUniforms() {
+	uniformsResolved = true;
+
+	///////////////////////////////////////////////////////////
+	// Resolve Uniforms (uniforms the variant does not use resolve to -1 and are skipped)
+	modelUniform = shader->getUniform<glm::mat4>("model");
+	materialUniform = shader->getUniform<int>("materialIndex");
+	positionScaleUniform = shader->getUniform<glm::vec3>("positionScale");
+	positionOffsetUniform = shader->getUniform<glm::vec3>("positionOffset");
+	drawOffsetUniform = shader->getUniform<int>("drawOffset");
+
+	// samplers are named by type and number, e.g. texture_diffuse1
+	unsigned int diffuseNr = 1;
 	unsigned int specularNr = 1;
-	unsigned int normalNr	= 1;
-	unsigned int heightNr	= 1;	
+	unsigned int normalNr = 1;
+	unsigned int alphaNr = 1;
 
-	shader.use();
+	textureUniforms.clear();
 
-	for (unsigned int i = 0; i < textures.size(); i++)	{
-		glActiveTexture(GL_TEXTURE0 + i);
-		// get texture number (diffuseNr)
+	for (unsigned int i = 0; i < textures.size(); i++) {
 		std::string number;
 		std::string type = textures[i].type;
 		if (type == "texture_diffuse")
-			number = std::to_string(diffueNr++);
+			number = std::to_string(diffuseNr++);
 		else if (type == "texture_specular")
 			number = std::to_string(specularNr++);
 		else if (type == "texture_normal")
 			number = std::to_string(normalNr++);
+		else if (type == "texture_alpha")
+			number = std::to_string(alphaNr++);
 
-		glUniform1i(glGetUniformLocation(shader.ID, (type + number).c_str()), i);
-		
-		// bind the texture
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		textureUniforms.push_back(shader->getUniform<int>(type + number));
 	}
+}
+
+// copies the interleaved vertices and 32-bit indices into the arena pool for the format
+bool Mesh::stageInArena(const std::vector<unsigned char>& vertices, UploadStats& uploadStats) {
+	// an empty mesh takes no arena space
+	if (vertices.empty())
+		return false;
+
+	std::vector<unsigned int> indices = vecData.indices;
+
+	// a multi draw needs indices, so unindexed meshes are given a sequential list
+	if (indices.empty()) {
+		indices.resize(vecData.vertices.size());
+		for (unsigned int i = 0; i < indices.size(); i++)
+			indices[i] = i;
+	}
+
+	indices = appendLodIndices(indices);
+
+	if (!geometryArena.allocate(format, vertices.data(), vecData.vertices.size(), indices, arena, uploadStats))
+		return false;
+
+	indexed = true;
+	indexType = GL_UNSIGNED_INT;
+	indexOffset = (size_t)arena.firstIndex * sizeof(GLuint);
+	baseVertex = arena.baseVertex;
+
+	if (vecData.indices.empty())
+		vecData.indices = indices;
+
+	stats.vertexBytes = vertices.size();
+	stats.indexBytes = indices.size() * sizeof(GLuint);
+
+	return true;
+}
+
+// level 0 followed by the simplified levels, each level's range is recorded for drawing
+std::vector<unsigned int> Mesh::appendLodIndices(const std::vector<unsigned int>& indices) {
+	std::vector<unsigned int> allIndices = indices;
+
+	LodRange range;
+	range.count = indices.size();
+	lodRanges.assign(1, range);
 
-	shader.setVec4("material.diffuse", mtlData.Kd);
+	for (unsigned int i = 0; i < lods.size() && i + 1 < MAX_LODS; i++) {
+		range.firstIndex = allIndices.size();
+		range.count = lods[i].indices.size();
+		lodRanges.push_back(range);
 
-	//shader.setVec3("material.ambient", mtlData.Ka);
+		allIndices.insert(allIndices.end(), lods[i].indices.begin(), lods[i].indices.end());
+	}
 
-	//shader.setVec3("material.specular", mtlData.Ks);
+	return allIndices;
+}
 
-	//shader.setFloat("material.shininess", mtlData.Ni);
+void Mesh::encodeFullPrecision(std::vector<unsigned char> streams[NUM_VERTEX_BUFFERS], bool hasNormals, bool hasUvs) {
+	positionScale = glm::vec3(1.0f);
+	positionOffset = glm::vec3(0.0f);
 
+	appendBytes(streams[VertexBufferValue::TRIANGLES], vecData.vertices);
 
-	glBindVertexArray(VAO);
-	glDrawArrays(GL_TRIANGLES, 0, vecData.vertices.size());
-	glBindVertexArray(0);
+	if (hasNormals)
+		appendBytes(streams[VertexBufferValue::NORMALS], vecData.normals);
 
-	// reset active texture
-	glActiveTexture(GL_TEXTURE0);
+	if (hasUvs)
+		appendBytes(streams[VertexBufferValue::TEXTURES], vecData.uvs);
 }
 
-void Mesh::setupMesh(Shader shader) {
+void Mesh::encodeQuantized(std::vector<unsigned char> streams[NUM_VERTEX_BUFFERS], bool hasNormals, bool hasUvs) {
+	size_t numVertices = vecData.vertices.size();
+	if (numVertices == 0)
+		return;
+
 	///////////////////////////////////////////////////////////
-	// Setup Buffers
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
+	// Positions: unorm16 relative to the mesh bounds, rebuilt in shader.vs
+	glm::vec3 minBound = vecData.vertices[0];
+	glm::vec3 maxBound = vecData.vertices[0];
 
-	glGenBuffers(NUM_VERTEX_BUFFERS, vertexBuffers);
+	for (unsigned int i = 1; i < numVertices; i++) {
+		minBound = glm::min(minBound, vecData.vertices[i]);
+		maxBound = glm::max(maxBound, vecData.vertices[i]);
+	}
 
-	// position buffer
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[VertexBufferValue::TRIANGLES]);
+	positionOffset = minBound;
+	positionScale = maxBound - minBound;
 
-	glBufferData(GL_ARRAY_BUFFER, vecData.vertices.size() * sizeof(glm::vec3), &vecData.vertices[0], GL_STATIC_DRAW);
+	// padded to 4 components so every vertex stays 4 byte aligned
+	std::vector<unsigned short> positions(numVertices * 4, 0);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-	glEnableVertexAttribArray(0);
+	for (unsigned int i = 0; i < numVertices; i++) {
+		for (int c = 0; c < 3; c++) {
+			float normalised = positionScale[c] > 0.0f ? (vecData.vertices[i][c] - minBound[c]) / positionScale[c] : 0.0f;
+			positions[i * 4 + c] = glm::packUnorm1x16(normalised);
 
+			float decoded = glm::unpackUnorm1x16(positions[i * 4 + c]) * positionScale[c] + positionOffset[c];
+			stats.maxPositionError = std::max(stats.maxPositionError, fabsf(decoded - vecData.vertices[i][c]));
+		}
+	}
 
-	// normal buffer
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[VertexBufferValue::NORMALS]);
+	appendBytes(streams[VertexBufferValue::TRIANGLES], positions);
 
-	glBufferData(GL_ARRAY_BUFFER, vecData.normals.size() * sizeof(glm::vec3), &vecData.normals[0], GL_STATIC_DRAW);
 
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-	glEnableVertexAttribArray(1);
+	///////////////////////////////////////////////////////////
+	// Normals: signed 10_10_10_2
+	if (hasNormals) {
+		std::vector<GLuint> normals(numVertices);
 
+		for (unsigned int i = 0; i < numVertices; i++) {
+			glm::vec3 normal = vecData.normals[i];
+			if (glm::length(normal) > 0.0f)
+				normal = glm::normalize(normal);
 
-	// texture buffer
-	if (!vecData.uvs.empty()) {
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[VertexBufferValue::TEXTURES]);
+			normals[i] = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
 
-		glBufferData(GL_ARRAY_BUFFER, vecData.uvs.size() * sizeof(glm::vec2), &vecData.uvs[0], GL_STATIC_DRAW);
+			glm::vec3 decoded = glm::vec3(glm::unpackSnorm3x10_1x2(normals[i]));
+			if (glm::length(decoded) > 0.0f && glm::length(normal) > 0.0f) {
+				float cosAngle = glm::clamp(glm::dot(normal, glm::normalize(decoded)), -1.0f, 1.0f);
+				stats.maxNormalError = std::max(stats.maxNormalError, glm::degrees(acosf(cosAngle)));
+			}
+		}
 
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-		glEnableVertexAttribArray(2);
+		appendBytes(streams[VertexBufferValue::NORMALS], normals);
 	}
 
-	shader.use();
 
-	if (textures.empty())
-		glUniform1i(glGetUniformLocation(shader.ID, "hasTexture"), false);
-	else
-		glUniform1i(glGetUniformLocation(shader.ID, "hasTexture"), true);
-}
\ No newline at end of file
+	///////////////////////////////////////////////////////////
+	// Uvs: half floats (keeps uvs outside of 0-1 for repeating textures)
+	if (hasUvs) {
+		std::vector<GLuint> uvs(numVertices);
+
+		for (unsigned int i = 0; i < numVertices; i++) {
+			uvs[i] = glm::packHalf2x16(vecData.uvs[i]);
+
+			glm::vec2 delta = glm::abs(glm::unpackHalf2x16(uvs[i]) - vecData.uvs[i]);
+			stats.maxUvError = std::max(stats.maxUvError, std::max(delta.x, delta.y));
+		}
+
+		appendBytes(streams[VertexBufferValue::TEXTURES], uvs);
+	}
+}
+
+
+template<typename T>
+void appendBytes(std::vector<unsigned char>& stream, const std::vector<T>& values) {
+	const unsigned char* bytes = (const unsigned char*)values.data();
+	stream.insert(stream.end(), bytes, bytes + values.size() * sizeof(T));
+}
@@ -9,6 +9,9 @@
 #include <glm/glm.hpp>
 
 #include "Shader.h"
+#include "MeshUploader.h"
+#include "GeometryArena.h"
+#include "VertexFormat.h"
 
 
 ///////////////////////////////////////////////////
@@ -18,12 +21,10 @@ enum MeshType {
 	DAE
 };
 
-enum VertexBufferValue {
-	TRIANGLES,
-	NORMALS,
-	TEXTURES,
-	COLOUR,
-	NUM_VERTEX_BUFFERS
+// Storage format of the vertex data in cache/converter blobs
+enum class MeshCompression {
+	NONE,
+	QUANTIZED
 };
 
 struct VecData {
@@ -31,6 +32,9 @@ struct VecData {
 	std::vector<glm::vec3> vertices;
 	std::vector<glm::vec2> uvs;
 	std::vector<glm::vec3> normals;
+	std::vector<unsigned int> indices;	// triangle list into the arrays above, empty if not indexed
+
+	size_t elementCount() const { return indices.empty() ? vertices.size() : indices.size(); }
 };
 
 struct MtlData {
@@ -41,12 +45,91 @@ struct MtlData {
 	glm::vec4 Ks = glm::vec4(0.0, 0.0, 0.0, 0.0);	// Specular colour
 	glm::vec4 Ke = glm::vec4(0.0, 0.0, 0.0, 0.0);	// Emissive coefficient
 	float Ni = NULL;								// Optical density (index of refraction)
-	float d = NULL;									// Dissolved value
+	float d = 1.0f;									// Dissolved value (below 1 is drawn blended)
 	int illum = NULL;								// Illumination model
 	std::string map_d;								// Alpha texture map
 	std::string map_Kd;								// Diffuse texture map
 };
 
+// Object space bounds, computed at import (the sphere is centred on the box)
+struct MeshBounds {
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+	glm::vec3 centre = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+const unsigned int MAX_LODS = 5; // levels of detail of a mesh, including the full mesh
+const unsigned int MIN_LODS = 3; // levels generated whenever the simplifier can still remove triangles (MeshSimplifier.h)
+
+// A simplified level of detail, generated at import (MeshSimplifier.h)
+struct MeshLod {
+	std::vector<unsigned int> indices;	// triangle list into the vertices of the full mesh
+	float error = 0.0f;					// object space distance the surface may have moved (estimated)
+};
+
+const unsigned int MAX_MESHLET_VERTICES = 64;
+const unsigned int MAX_MESHLET_TRIANGLES = 124;
+
+// A cluster of neighbouring triangles, contiguous in the level 0 indices (MeshProcessing.h)
+struct Meshlet {
+	unsigned int firstIndex = 0;
+	unsigned int triangleCount = 0;
+	glm::vec3 centre = glm::vec3(0.0f);		// object space bounding sphere
+	float radius = 0.0f;
+	glm::vec3 coneAxis = glm::vec3(0.0f);	// average facing of the triangles
+	float coneCutoff = 1.0f;				// sine of the normal cone's half angle, 1 if the triangles never all face away
+};
+
+// One of the imported meshes merged into a batch (MeshProcessing.h), contiguous in the level 0 indices
+struct MeshPart {
+	unsigned int firstIndex = 0;
+	unsigned int triangleCount = 0;
+	MeshBounds bounds;	// object space, as imported
+};
+
+// Where a level's indices start within the mesh's index data
+struct LodRange {
+	GLuint firstIndex = 0;
+	GLsizei count = 0;
+};
+
+// Post-transform vertex cache misses of a triangle list (IndexOptimizer.h)
+struct VertexCacheStats {
+	size_t triangles = 0;
+	size_t vertices = 0;
+	size_t misses = 0;
+
+	float acmr() const { return triangles > 0 ? (float)misses / triangles : 0.0f; }	// misses per triangle, 0.5 at best
+	float atvr() const { return vertices > 0 ? (float)misses / vertices : 0.0f; }	// misses per vertex, 1 at best
+
+	void add(const VertexCacheStats& other) {
+		triangles += other.triangles;
+		vertices += other.vertices;
+		misses += other.misses;
+	}
+};
+
+// GPU memory used by a mesh and the error introduced by its vertex precision
+struct MeshStats {
+	size_t vertexBytes = 0;
+	size_t indexBytes = 0;
+	float maxPositionError = 0.0f;	// world units
+	float maxNormalError = 0.0f;	// degrees
+	float maxUvError = 0.0f;
+	unsigned int lodTriangles[MAX_LODS] = {};	// per level of detail, 0 past the last level
+	unsigned int meshlets = 0;
+	VertexCacheStats vertexCache;	// level 0 in its uploaded order
+};
+
+// Per draw data read by the MULTI_DRAW shader variant (std430 layout of DrawData in shader.vs)
+struct MeshDrawData {
+	glm::vec4 positionScale;	// xyz, w unused
+	glm::vec4 positionOffset;	// xyz, w unused
+	GLint material;				// index into the material table
+	GLint padding[3];
+};
+
 struct Texture {
 	unsigned int id;
 	std::string type;
@@ -56,22 +139,100 @@ struct Texture {
 class Mesh {
 public:
 	MeshType meshType;
+	MeshCompression compression = MeshCompression::NONE;
+	VertexPrecision precision = VertexPrecision::FULL;
+	VertexLayout layout = VertexLayout::INTERLEAVED;
+	GLsizei strideAlignment = 4;
 
 	std::string path;
 
 	VecData vecData;
 	MtlData mtlData;
+	MeshBounds bounds;
+	std::vector<MeshLod> lods; // levels 1 and up, coarser each level (level 0 is vecData.indices)
+	std::vector<Meshlet> meshlets; // clusters of level 0, empty when the mesh fits in one
+	std::vector<MeshPart> parts; // meshes batched into this one at import, empty if it was not batched
 
 	std::vector<Texture> textures;
+	unsigned int materialIndex = 0; // into the material table (MaterialTable.h), set when the mesh is set up
+
+	MeshStats stats;
+
+	bool instanced = false; // transforms come from an instance or storage buffer (set by the render queue)
+
+	static bool texturesEnabled; // toggled for every mesh with key 3
 
 	Mesh();
 
-	void draw(Shader shader);
-	void setupMesh(Shader shader);
+	// the camera comes from the frame's Camera block (FrameUniforms.h)
+	void draw(const glm::mat4& model);
+
+	// draw steps, used by the render queue to skip state that has not changed
+	bool prepareShader();	// false while the variant is still compiling
+	void setTransform(const glm::mat4& model);
+	void bindTextures();
+	void bindMaterial();
+	void bindVertexArray();
+	void bindInstanceBuffer(GLuint buffer, size_t offset = 0);	// the vertex array must be bound
+	void setDrawOffset(GLuint offset);	// draw data index of the first command in a multi draw
+	void drawGeometry(GLsizei instanceCount = 1, GLuint baseInstance = 0, unsigned int lod = 0);
+
+	// multi draw command and draw data, for meshes in the geometry arena
+	DrawElementsIndirectCommand getDrawCommand(GLuint instanceCount, GLuint baseInstance, unsigned int lod = 0) const;
+	MeshDrawData getDrawData() const;
+
+	Shader* getShader() const { return shader; }
+	GLuint getVertexArray() const { return VAO; }
+	bool isBlended() const { return mtlData.d < 1.0f; }
+	bool inArena() const { return arena.pool != NULL; }
+	unsigned int getLodCount() const { return 1 + lods.size(); }
+	float getLodError(unsigned int lod) const { return lod == 0 ? 0.0f : lods[lod - 1].error; }
+
+	// interleaved meshes are copied into the geometry arena when useArena is set, anything else is staged
+	void stageMesh(MeshUploader& uploader, bool useArena = false);
+	void setupMesh(GLuint buffer, UploadStats& uploadStats);
+	void releaseMesh();
+
+	// ShaderFeature flags of the most specialized shader variant for this mesh
+	unsigned int getShaderFeatures() const;
 private:
-	unsigned int VAO = NULL;
-
-	GLuint vertexBuffers[NUM_VERTEX_BUFFERS];
+	unsigned int VAO = NULL; // belongs to the arena pool when the mesh is in the arena
+
+	// format and offsets into the model buffer the mesh was staged into
+	VertexFormat format;
+	size_t attributeOffsets[NUM_VERTEX_BUFFERS];
+	GLuint instanceBuffer = 0; // buffer and offset the instance attributes of the vertex array point at
+	size_t instanceOffset = 0;
+	bool indexed = false;
+	size_t indexOffset = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	GLint baseVertex = 0;
+	ArenaAllocation arena;
+	std::vector<LodRange> lodRanges; // relative to indexOffset, one per level once indexed
+
+	// applied to the positions in shader.vs (identity unless quantized)
+	glm::vec3 positionScale = glm::vec3(1.0f);
+	glm::vec3 positionOffset = glm::vec3(0.0f);
+
+	// shader variant and its uniform handles, resolved once the variant has compiled
+	Shader* shader = NULL;
+	unsigned int shaderFeatures = 0;
+	bool uniformsResolved = false;
+	Uniform<glm::mat4> modelUniform;
+	Uniform<int> materialUniform;
+	Uniform<glm::vec3> positionScaleUniform;
+	Uniform<glm::vec3> positionOffsetUniform;
+	Uniform<int> drawOffsetUniform;
+	std::vector<Uniform<int>> textureUniforms;
+
+	void selectShader(unsigned int features);
+	void resolveUniforms();
+
+	bool stageInArena(const std::vector<unsigned char>& vertices, UploadStats& uploadStats);
+	std::vector<unsigned int> appendLodIndices(const std::vector<unsigned int>& indices);
+
+	void encodeFullPrecision(std::vector<unsigned char> streams[NUM_VERTEX_BUFFERS], bool hasNormals, bool hasUvs);
+	void encodeQuantized(std::vector<unsigned char> streams[NUM_VERTEX_BUFFERS], bool hasNormals, bool hasUvs);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,747 @@
+#include "MeshCodec.h"
+#include "Hash.h"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <string>
+#include <iostream>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESHCODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+
+///////////////////////////////////////////////////
+// DataTypes
+const uint32_t CODEC_MAGIC = 0x5A4D454A; // "JEMZ"
+const uint32_t CODEC_HAS_UVS = 1;
+const uint32_t CODEC_HAS_NORMALS = 2;
+
+const uint32_t RANS_SCALE_BITS = 12;
+const uint32_t RANS_SCALE = 1 << RANS_SCALE_BITS;
+const uint32_t RANS_LOWER_BOUND = 1 << 23;
+const uint32_t RANS_LANES = 4; // interleaved states, so the decoder's dependency chains overlap
+
+struct CodecHeader {
+	uint32_t magic;
+	uint32_t flags;
+	uint32_t numVertices;	// unique (quantized) vertices
+	uint32_t numIndices;
+	glm::vec3 positionMin;
+	glm::vec3 positionScale;
+	glm::vec2 uvMin;
+	glm::vec2 uvScale;
+};
+
+struct QuantizedVertex {
+	uint16_t values[7]; // position xyz, normal xy, uv xy
+
+	bool operator==(const QuantizedVertex& other) const {
+		return memcmp(values, other.values, sizeof(values)) == 0;
+	}
+};
+
+struct QuantizedVertexHash {
+	size_t operator()(const QuantizedVertex& vertex) const {
+		return (size_t)hashBytes(vertex.values, sizeof(vertex.values));
+	}
+};
+
+// Decoder lookup for one of the RANS_SCALE slots
+struct RansSlot {
+	uint16_t freq;
+	uint16_t bias;	// slot minus the first slot of the symbol
+	unsigned char symbol;
+};
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+uint16_t quantizeUnorm16(float value, float min, float scale);
+void encodeOctahedral(glm::vec3 normal, uint16_t& x, uint16_t& y);
+void encodeIndices(const std::vector<uint32_t>& indices, std::vector<unsigned char>& out);
+bool decodeIndices(const unsigned char*& ptr, const unsigned char* end, uint32_t numIndices, uint32_t numVertices, std::vector<unsigned int>& indices);
+void ransEncode(const std::vector<unsigned char>& input, std::vector<unsigned char>& out);
+bool ransDecode(const unsigned char*& ptr, const unsigned char* end, std::vector<unsigned char>& output);
+void dequantizePositions(const uint16_t* inX, const uint16_t* inY, const uint16_t* inZ, glm::vec3* out, size_t count, const glm::vec3& min, const glm::vec3& scale);
+void dequantizeUvs(const uint16_t* inX, const uint16_t* inY, glm::vec2* out, size_t count, const glm::vec2& min, const glm::vec2& scale);
+void decodeOctahedralPlanes(const uint16_t* inX, const uint16_t* inY, glm::vec3* out, size_t count);
+template<typename T> void appendPlane(std::vector<unsigned char>& out, const std::vector<T>& plane);
+
+
+std::vector<unsigned char> encodeVecData(const VecData& vecData) {
+	CodecHeader header;
+	header.magic = CODEC_MAGIC;
+	header.flags = 0;
+
+	size_t numSourceVertices = vecData.vertices.size();
+	size_t numCorners = vecData.elementCount();
+	bool hasUvs = vecData.uvs.size() == numSourceVertices && numSourceVertices > 0;
+	bool hasNormals = vecData.normals.size() == numSourceVertices && numSourceVertices > 0;
+
+	if (hasUvs)
+		header.flags |= CODEC_HAS_UVS;
+	if (hasNormals)
+		header.flags |= CODEC_HAS_NORMALS;
+
+	///////////////////////////////////////////////////
+	// Quantization ranges
+	glm::vec3 positionMin(0.0f), positionMax(0.0f);
+	glm::vec2 uvMin(0.0f), uvMax(0.0f);
+
+	if (numSourceVertices > 0) {
+		positionMin = positionMax = vecData.vertices[0];
+		for (size_t i = 1; i < numSourceVertices; i++) {
+			positionMin = glm::min(positionMin, vecData.vertices[i]);
+			positionMax = glm::max(positionMax, vecData.vertices[i]);
+		}
+	}
+
+	if (hasUvs) {
+		uvMin = uvMax = vecData.uvs[0];
+		for (size_t i = 1; i < numSourceVertices; i++) {
+			uvMin = glm::min(uvMin, vecData.uvs[i]);
+			uvMax = glm::max(uvMax, vecData.uvs[i]);
+		}
+	}
+
+	header.positionMin = positionMin;
+	header.positionScale = (positionMax - positionMin) / 65535.0f;
+	header.uvMin = uvMin;
+	header.uvScale = (uvMax - uvMin) / 65535.0f;
+
+	///////////////////////////////////////////////////
+	// Quantize and de-duplicate vertices
+	std::unordered_map<QuantizedVertex, uint32_t, QuantizedVertexHash> vertexLookup;
+	std::vector<QuantizedVertex> uniqueVertices;
+	std::vector<uint32_t> indices;
+	indices.reserve(numCorners);
+
+	for (size_t corner = 0; corner < numCorners; corner++) {
+		size_t i = vecData.indices.empty() ? corner : vecData.indices[corner];
+
+		QuantizedVertex vertex;
+		memset(&vertex, 0, sizeof(vertex));
+
+		for (int c = 0; c < 3; c++)
+			vertex.values[c] = quantizeUnorm16(vecData.vertices[i][c], positionMin[c], header.positionScale[c]);
+
+		if (hasNormals)
+			encodeOctahedral(vecData.normals[i], vertex.values[3], vertex.values[4]);
+
+		if (hasUvs) {
+			vertex.values[5] = quantizeUnorm16(vecData.uvs[i].x, uvMin.x, header.uvScale.x);
+			vertex.values[6] = quantizeUnorm16(vecData.uvs[i].y, uvMin.y, header.uvScale.y);
+		}
+
+		auto found = vertexLookup.find(vertex);
+		if (found != vertexLookup.end()) {
+			indices.push_back(found->second);
+		}
+		else {
+			uint32_t index = (uint32_t)uniqueVertices.size();
+			vertexLookup[vertex] = index;
+			uniqueVertices.push_back(vertex);
+			indices.push_back(index);
+		}
+	}
+
+	header.numVertices = (uint32_t)uniqueVertices.size();
+	header.numIndices = (uint32_t)indices.size();
+
+	///////////////////////////////////////////////////
+	// Write the header and attribute planes
+	std::vector<unsigned char> out((const unsigned char*)&header, (const unsigned char*)&header + sizeof(header));
+	std::vector<uint16_t> plane(uniqueVertices.size());
+
+	for (int c = 0; c < 7; c++) {
+		if ((c == 3 || c == 4) && !hasNormals)
+			continue;
+		if ((c == 5 || c == 6) && !hasUvs)
+			continue;
+
+		for (size_t i = 0; i < uniqueVertices.size(); i++)
+			plane[i] = uniqueVertices[i].values[c];
+
+		appendPlane(out, plane);
+	}
+
+	encodeIndices(indices, out);
+
+	return out;
+}
+
+bool decodeVecData(const unsigned char* data, size_t size, VecData& vecData) {
+	if (size < sizeof(CodecHeader))
+		return false;
+
+	CodecHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	if (header.magic != CODEC_MAGIC)
+		return false;
+
+	bool hasUvs = (header.flags & CODEC_HAS_UVS) != 0;
+	bool hasNormals = (header.flags & CODEC_HAS_NORMALS) != 0;
+	size_t numPlanes = 3 + (hasNormals ? 2 : 0) + (hasUvs ? 2 : 0);
+	size_t planeBytes = header.numVertices * sizeof(uint16_t);
+
+	const unsigned char* ptr = data + sizeof(header);
+	const unsigned char* end = data + size;
+
+	if ((size_t)(end - ptr) < numPlanes * planeBytes)
+		return false;
+
+	// planes are copied out so they are aligned for the simd loads
+	std::vector<uint16_t> planes(numPlanes * header.numVertices);
+	if (!planes.empty())
+		memcpy(planes.data(), ptr, numPlanes * planeBytes);
+	ptr += numPlanes * planeBytes;
+
+	// checked against the vertex count as they are decoded
+	std::vector<unsigned int> indices;
+	if (!decodeIndices(ptr, end, header.numIndices, header.numVertices, indices))
+		return false;
+
+	///////////////////////////////////////////////////
+	// Dequantize unique vertices straight into the VecData layout
+	size_t numVertices = header.numVertices;
+	std::vector<glm::vec3> positions(numVertices);
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+
+	// planes are addressed through data(), an empty mesh has nothing to index
+	const uint16_t* plane = planes.data();
+
+	dequantizePositions(plane, plane + numVertices, plane + 2 * numVertices, positions.data(), numVertices, header.positionMin, header.positionScale);
+
+	size_t nextPlane = 3;
+
+	if (hasNormals) {
+		normals.resize(numVertices);
+		decodeOctahedralPlanes(plane + nextPlane * numVertices, plane + (nextPlane + 1) * numVertices, normals.data(), numVertices);
+		nextPlane += 2;
+	}
+
+	if (hasUvs) {
+		uvs.resize(numVertices);
+		dequantizeUvs(plane + nextPlane * numVertices, plane + (nextPlane + 1) * numVertices, uvs.data(), numVertices, header.uvMin, header.uvScale);
+	}
+
+	vecData.vertices.swap(positions);
+	vecData.normals.swap(normals);
+	vecData.uvs.swap(uvs);
+	vecData.indices.swap(indices);
+
+	return true;
+}
+
+CodecError measureCodecError(const VecData& original, const VecData& decoded) {
+	CodecError error;
+
+	size_t numCorners = original.elementCount();
+	bool hasNormals = !original.normals.empty();
+	bool hasUvs = !original.uvs.empty();
+
+	if (numCorners != decoded.elementCount()
+		|| hasNormals != !decoded.normals.empty()
+		|| hasUvs != !decoded.uvs.empty()) {
+		error.sizesMatch = false;
+		return error;
+	}
+
+	// compared per triangle corner, as the two sides may be indexed differently
+	for (size_t corner = 0; corner < numCorners; corner++) {
+		size_t a = original.indices.empty() ? corner : original.indices[corner];
+		size_t b = decoded.indices.empty() ? corner : decoded.indices[corner];
+
+		glm::vec3 delta = glm::abs(original.vertices[a] - decoded.vertices[b]);
+		error.maxPositionError = std::max(error.maxPositionError, std::max(delta.x, std::max(delta.y, delta.z)));
+
+		if (hasNormals) {
+			float lengths = glm::length(original.normals[a]) * glm::length(decoded.normals[b]);
+			if (lengths > 0.0f) {
+				float cosAngle = glm::clamp(glm::dot(original.normals[a], decoded.normals[b]) / lengths, -1.0f, 1.0f);
+				error.maxNormalError = std::max(error.maxNormalError, glm::degrees(acosf(cosAngle)));
+			}
+		}
+
+		if (hasUvs) {
+			glm::vec2 uvDelta = glm::abs(original.uvs[a] - decoded.uvs[b]);
+			error.maxUvError = std::max(error.maxUvError, std::max(uvDelta.x, uvDelta.y));
+		}
+	}
+
+	return error;
+}
+
+bool testEntropyCoder() {
+	std::vector<std::pair<std::string, std::vector<unsigned char>>> cases;
+	uint32_t seed = 12345;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+	cases.push_back(std::make_pair("empty", std::vector<unsigned char>()));
+	cases.push_back(std::make_pair("one byte", std::vector<unsigned char>(1, 42)));
+	cases.push_back(std::make_pair("one symbol", std::vector<unsigned char>(100000, 7)));
+
+	// frequencies of 15.99 / 4096 round down to 15, every symbol costs more than its share
+	std::vector<unsigned char> roundedDown;
+	for (int s = 0; s < 256; s++)
+		roundedDown.insert(roundedDown.end(), s == 255 ? 1160 : 1000, (unsigned char)s);
+	cases.push_back(std::make_pair("255 symbols rounded down", roundedDown));
+
+	std::vector<unsigned char> uniform(200000);
+	for (unsigned char& byte : uniform)
+		byte = (unsigned char)random();
+	cases.push_back(std::make_pair("uniform", uniform));
+
+	// every other symbol once, so each is forced up to frequency 1
+	std::vector<unsigned char> skewed(500000, 0);
+	for (int s = 1; s < 256; s++)
+		skewed[random() % skewed.size()] = (unsigned char)s;
+	cases.push_back(std::make_pair("skewed", skewed));
+
+	std::vector<unsigned char> alternating(100001);
+	for (size_t i = 0; i < alternating.size(); i++)
+		alternating[i] = i % 2 ? 0 : 255;
+	cases.push_back(std::make_pair("alternating", alternating));
+
+	// the rounded down case again, shuffled so runs do not help
+	for (size_t i = roundedDown.size() - 1; i > 0; i--)
+		std::swap(roundedDown[i], roundedDown[random() % (i + 1)]);
+	cases.push_back(std::make_pair("255 symbols rounded down, shuffled", roundedDown));
+
+	bool passed = true;
+
+	for (const auto& test : cases) {
+		std::vector<unsigned char> encoded, decoded;
+		ransEncode(test.second, encoded);
+
+		const unsigned char* ptr = encoded.data();
+		if (!ransDecode(ptr, encoded.data() + encoded.size(), decoded) || decoded != test.second || ptr != encoded.data() + encoded.size()) {
+			std::cout << "ERROR->" << __FUNCTION__ << ": round trip failed for " << test.first << " (" << test.second.size() << " bytes)" << std::endl;
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+
+uint16_t quantizeUnorm16(float value, float min, float scale) {
+	if (scale <= 0.0f)
+		return 0;
+
+	float q = (value - min) / scale + 0.5f;
+	return (uint16_t)std::min(std::max(q, 0.0f), 65535.0f);
+}
+
+void encodeOctahedral(glm::vec3 normal, uint16_t& x, uint16_t& y) {
+	float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	if (length <= 0.0f) {
+		x = y = 0;
+		return;
+	}
+
+	// project onto the octahedron and fold the lower hemisphere over
+	glm::vec2 oct(normal.x / length, normal.y / length);
+	if (normal.z < 0.0f) {
+		oct = glm::vec2(
+			(1.0f - fabsf(oct.y)) * (oct.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - fabsf(oct.x)) * (oct.y >= 0.0f ? 1.0f : -1.0f));
+	}
+
+	x = (uint16_t)(int16_t)roundf(glm::clamp(oct.x, -1.0f, 1.0f) * 32767.0f);
+	y = (uint16_t)(int16_t)roundf(glm::clamp(oct.y, -1.0f, 1.0f) * 32767.0f);
+}
+
+
+void encodeIndices(const std::vector<uint32_t>& indices, std::vector<unsigned char>& out) {
+	///////////////////////////////////////////////////
+	// Delta + zigzag + varint
+	std::vector<unsigned char> bytes;
+	bytes.reserve(indices.size() * 2);
+
+	uint32_t previous = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		int32_t delta = (int32_t)(indices[i] - previous);
+		uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+		previous = indices[i];
+
+		while (zigzag >= 0x80) {
+			bytes.push_back((unsigned char)(zigzag | 0x80));
+			zigzag >>= 7;
+		}
+		bytes.push_back((unsigned char)zigzag);
+	}
+
+	ransEncode(bytes, out);
+}
+
+bool decodeIndices(const unsigned char*& ptr, const unsigned char* end, uint32_t numIndices, uint32_t numVertices, std::vector<unsigned int>& indices) {
+	std::vector<unsigned char> bytes;
+	if (!ransDecode(ptr, end, bytes))
+		return false;
+
+	indices.resize(numIndices);
+
+	const unsigned char* pos = bytes.data();
+	const unsigned char* bytesEnd = pos + bytes.size();
+	uint32_t previous = 0;
+
+	for (uint32_t i = 0; i < numIndices; i++) {
+		uint32_t zigzag;
+
+		// neighbouring indices are mostly a single byte apart
+		if (pos < bytesEnd && *pos < 0x80) {
+			zigzag = *pos++;
+		}
+		else {
+			zigzag = 0;
+			int shift = 0;
+
+			while (true) {
+				if (pos >= bytesEnd || shift > 28)
+					return false;
+
+				unsigned char byte = *pos++;
+				zigzag |= (uint32_t)(byte & 0x7F) << shift;
+				shift += 7;
+
+				if (!(byte & 0x80))
+					break;
+			}
+		}
+
+		int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+		previous += (uint32_t)delta;
+
+		if (previous >= numVertices)
+			return false;
+
+		indices[i] = previous;
+	}
+
+	return true;
+}
+
+
+void ransEncode(const std::vector<unsigned char>& input, std::vector<unsigned char>& out) {
+	///////////////////////////////////////////////////
+	// Normalise symbol frequencies to RANS_SCALE
+	uint32_t counts[256] = { 0 };
+	for (size_t i = 0; i < input.size(); i++)
+		counts[input[i]]++;
+
+	uint16_t freqs[256] = { 0 };
+	uint32_t total = 0;
+	int largest = 0;
+
+	for (int s = 0; s < 256; s++) {
+		if (counts[s] == 0)
+			continue;
+
+		freqs[s] = (uint16_t)std::max<uint64_t>(1, (uint64_t)counts[s] * RANS_SCALE / input.size());
+		total += freqs[s];
+
+		if (freqs[s] > freqs[largest])
+			largest = s;
+	}
+
+	// fix rounding on the most frequent symbol (never drops it below 1)
+	if (!input.empty()) {
+		while (total > RANS_SCALE) {
+			for (int s = 0; s < 256 && total > RANS_SCALE; s++) {
+				if (freqs[s] > 1 && s != largest) {
+					freqs[s]--;
+					total--;
+				}
+			}
+			if (total > RANS_SCALE && freqs[largest] > 1) {
+				freqs[largest]--;
+				total--;
+			}
+		}
+		freqs[largest] += (uint16_t)(RANS_SCALE - total);
+	}
+
+	uint32_t starts[256];
+	uint32_t start = 0;
+	for (int s = 0; s < 256; s++) {
+		starts[s] = start;
+		start += freqs[s];
+	}
+
+	///////////////////////////////////////////////////
+	// Encode backwards so the decoder can read forwards
+	// (a symbol of frequency 1 costs 12 bits, renormalised a byte at a time that is at most 2 bytes,
+	// so near uniform data whose frequencies round down can grow past its raw size)
+	// (symbol i goes to state i % RANS_LANES, the states share one byte stream)
+	std::vector<unsigned char> encoded(input.size() * 2 + RANS_LANES * 4);
+	unsigned char* ptr = encoded.data() + encoded.size();
+	uint32_t states[RANS_LANES];
+
+	for (uint32_t lane = 0; lane < RANS_LANES; lane++)
+		states[lane] = RANS_LOWER_BOUND;
+
+	for (size_t i = input.size(); i > 0; i--) {
+		uint32_t& state = states[(i - 1) % RANS_LANES];
+		unsigned char symbol = input[i - 1];
+		uint32_t freq = freqs[symbol];
+		uint32_t stateMax = ((RANS_LOWER_BOUND >> RANS_SCALE_BITS) << 8) * freq;
+
+		while (state >= stateMax) {
+			*--ptr = (unsigned char)(state & 0xFF);
+			state >>= 8;
+		}
+
+		state = ((state / freq) << RANS_SCALE_BITS) + (state % freq) + starts[symbol];
+	}
+
+	// the first lane ends up first in the stream
+	for (uint32_t lane = RANS_LANES; lane > 0; lane--) {
+		uint32_t state = states[lane - 1];
+		ptr -= 4;
+		ptr[0] = (unsigned char)(state >> 0);
+		ptr[1] = (unsigned char)(state >> 8);
+		ptr[2] = (unsigned char)(state >> 16);
+		ptr[3] = (unsigned char)(state >> 24);
+	}
+
+	uint32_t rawSize = (uint32_t)input.size();
+	uint32_t encodedSize = (uint32_t)(encoded.data() + encoded.size() - ptr);
+
+	// only the used symbols are stored, small meshes would otherwise be dominated by the table
+	uint16_t numSymbols = 0;
+	for (int s = 0; s < 256; s++)
+		if (freqs[s] > 0)
+			numSymbols++;
+
+	out.insert(out.end(), (const unsigned char*)&rawSize, (const unsigned char*)&rawSize + 4);
+	out.insert(out.end(), (const unsigned char*)&encodedSize, (const unsigned char*)&encodedSize + 4);
+	out.insert(out.end(), (const unsigned char*)&numSymbols, (const unsigned char*)&numSymbols + 2);
+
+	for (int s = 0; s < 256; s++) {
+		if (freqs[s] == 0)
+			continue;
+
+		out.push_back((unsigned char)s);
+		out.insert(out.end(), (const unsigned char*)&freqs[s], (const unsigned char*)&freqs[s] + 2);
+	}
+
+	out.insert(out.end(), ptr, ptr + encodedSize);
+}
+
+// Decodes one symbol and renormalises without bounds checks, see ransDecode
+inline unsigned char ransDecodeSymbol(uint32_t& state, const RansSlot* slots, const unsigned char*& stream) {
+	const RansSlot& slot = slots[state & (RANS_SCALE - 1)];
+	unsigned char symbol = slot.symbol;
+	uint32_t next = slot.freq * (state >> RANS_SCALE_BITS) + slot.bias;
+	while (next < RANS_LOWER_BOUND)
+		next = (next << 8) | *stream++;
+	state = next;
+	return symbol;
+}
+
+bool ransDecode(const unsigned char*& ptr, const unsigned char* end, std::vector<unsigned char>& output) {
+	uint32_t rawSize, encodedSize;
+	uint16_t numSymbols;
+	uint16_t freqs[256] = { 0 };
+
+	if ((size_t)(end - ptr) < 10)
+		return false;
+
+	memcpy(&rawSize, ptr, 4);
+	memcpy(&encodedSize, ptr + 4, 4);
+	memcpy(&numSymbols, ptr + 8, 2);
+	ptr += 10;
+
+	if (numSymbols > 256 || (size_t)(end - ptr) < numSymbols * 3u)
+		return false;
+
+	for (uint16_t i = 0; i < numSymbols; i++) {
+		memcpy(&freqs[ptr[0]], ptr + 1, 2);
+		ptr += 3;
+	}
+
+	if ((size_t)(end - ptr) < encodedSize || encodedSize < RANS_LANES * 4)
+		return false;
+
+	const unsigned char* stream = ptr;
+	const unsigned char* streamEnd = ptr + encodedSize;
+	ptr = streamEnd;
+
+	///////////////////////////////////////////////////
+	// Slot lookup table, one load per decoded symbol
+	RansSlot slots[RANS_SCALE];
+	uint32_t start = 0;
+
+	for (int s = 0; s < 256; s++) {
+		if (start + freqs[s] > RANS_SCALE)
+			return false;
+
+		for (uint32_t slot = start; slot < start + freqs[s]; slot++) {
+			slots[slot].freq = freqs[s];
+			slots[slot].bias = (uint16_t)(slot - start);
+			slots[slot].symbol = (unsigned char)s;
+		}
+		start += freqs[s];
+	}
+
+	if (rawSize > 0 && start != RANS_SCALE)
+		return false;
+
+	uint32_t states[RANS_LANES];
+	for (uint32_t lane = 0; lane < RANS_LANES; lane++) {
+		states[lane] = stream[0] | (stream[1] << 8) | (stream[2] << 16) | ((uint32_t)stream[3] << 24);
+		stream += 4;
+
+		// out of range states would break the two byte renormalisation bound
+		if (states[lane] < RANS_LOWER_BOUND || states[lane] >= RANS_LOWER_BOUND << 8)
+			return false;
+	}
+
+	output.resize(rawSize);
+	unsigned char* out = output.data();
+
+	///////////////////////////////////////////////////
+	// One symbol per lane per step, renormalising reads at most two bytes per symbol,
+	// so the stream is only bounds checked once per step until its last few bytes.
+	// The lanes are spelled out so their states stay in registers
+	uint32_t i = 0;
+
+	for (; i + RANS_LANES <= rawSize && (size_t)(streamEnd - stream) >= RANS_LANES * 2; i += RANS_LANES) {
+		static_assert(RANS_LANES == 4, "one ransDecodeSymbol per lane");
+		out[i + 0] = ransDecodeSymbol(states[0], slots, stream);
+		out[i + 1] = ransDecodeSymbol(states[1], slots, stream);
+		out[i + 2] = ransDecodeSymbol(states[2], slots, stream);
+		out[i + 3] = ransDecodeSymbol(states[3], slots, stream);
+	}
+
+	for (; i < rawSize; i++) {
+		uint32_t& state = states[i % RANS_LANES];
+		const RansSlot& slot = slots[state & (RANS_SCALE - 1)];
+		out[i] = slot.symbol;
+
+		state = slot.freq * (state >> RANS_SCALE_BITS) + slot.bias;
+		while (state < RANS_LOWER_BOUND) {
+			if (stream >= streamEnd)
+				return false;
+			state = (state << 8) | *stream++;
+		}
+	}
+
+	return true;
+}
+
+
+void dequantizePositions(const uint16_t* inX, const uint16_t* inY, const uint16_t* inZ, glm::vec3* out, size_t count, const glm::vec3& min, const glm::vec3& scale) {
+	size_t i = 0;
+
+#ifdef MESHCODEC_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	alignas(16) float xs[4], ys[4], zs[4];
+
+	// 4 vertices per iteration: widen u16 -> i32 -> float, scale + offset, then interleave
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(inX + i)), zero));
+		__m128 y = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(inY + i)), zero));
+		__m128 z = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(inZ + i)), zero));
+
+		_mm_store_ps(xs, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(scale.x)), _mm_set1_ps(min.x)));
+		_mm_store_ps(ys, _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(scale.y)), _mm_set1_ps(min.y)));
+		_mm_store_ps(zs, _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(scale.z)), _mm_set1_ps(min.z)));
+
+		for (int j = 0; j < 4; j++)
+			out[i + j] = glm::vec3(xs[j], ys[j], zs[j]);
+	}
+#endif
+
+	for (; i < count; i++)
+		out[i] = glm::vec3(min.x + inX[i] * scale.x, min.y + inY[i] * scale.y, min.z + inZ[i] * scale.z);
+}
+
+void dequantizeUvs(const uint16_t* inX, const uint16_t* inY, glm::vec2* out, size_t count, const glm::vec2& min, const glm::vec2& scale) {
+	size_t i = 0;
+
+#ifdef MESHCODEC_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 minVec = _mm_setr_ps(min.x, min.y, min.x, min.y);
+	const __m128 scaleVec = _mm_setr_ps(scale.x, scale.y, scale.x, scale.y);
+
+	// interleave the u16 planes first, so every float lane is already (u, v) ordered
+	for (; i + 4 <= count; i += 4) {
+		__m128i uv = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(inX + i)), _mm_loadl_epi64((const __m128i*)(inY + i)));
+		__m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(uv, zero));
+		__m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(uv, zero));
+		_mm_storeu_ps((float*)(out + i), _mm_add_ps(_mm_mul_ps(lo, scaleVec), minVec));
+		_mm_storeu_ps((float*)(out + i + 2), _mm_add_ps(_mm_mul_ps(hi, scaleVec), minVec));
+	}
+#endif
+
+	for (; i < count; i++)
+		out[i] = glm::vec2(min.x + inX[i] * scale.x, min.y + inY[i] * scale.y);
+}
+
+void decodeOctahedralPlanes(const uint16_t* inX, const uint16_t* inY, glm::vec3* out, size_t count) {
+	size_t i = 0;
+
+#ifdef MESHCODEC_SSE2
+	const __m128 invScale = _mm_set1_ps(1.0f / 32767.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	alignas(16) float xs[4], ys[4], zs[4];
+
+	for (; i + 4 <= count; i += 4) {
+		// sign extend 4 snorm16 values per axis, -32768 clamps to -1 as in the scalar tail
+		__m128i rawX = _mm_loadl_epi64((const __m128i*)(inX + i));
+		__m128i rawY = _mm_loadl_epi64((const __m128i*)(inY + i));
+		__m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(rawX, rawX), 16)), invScale);
+		__m128 y = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(rawY, rawY), 16)), invScale);
+		x = _mm_max_ps(x, minusOne);
+		y = _mm_max_ps(y, minusOne);
+
+		// z = 1 - |x| - |y|, unfold the lower hemisphere where z < 0
+		__m128 z = _mm_sub_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, x)), _mm_andnot_ps(signMask, y));
+		__m128 t = _mm_max_ps(_mm_sub_ps(zero, z), zero);
+		x = _mm_sub_ps(x, _mm_or_ps(t, _mm_and_ps(x, signMask)));
+		y = _mm_sub_ps(y, _mm_or_ps(t, _mm_and_ps(y, signMask)));
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		__m128 invLength = _mm_div_ps(one, length);
+
+		_mm_store_ps(xs, _mm_mul_ps(x, invLength));
+		_mm_store_ps(ys, _mm_mul_ps(y, invLength));
+		_mm_store_ps(zs, _mm_mul_ps(z, invLength));
+
+		for (int j = 0; j < 4; j++)
+			out[i + j] = glm::vec3(xs[j], ys[j], zs[j]);
+	}
+#endif
+
+	// the same operations in the same order as the SIMD body, so both give identical normals
+	for (; i < count; i++) {
+		float x = std::max((int16_t)inX[i] * (1.0f / 32767.0f), -1.0f);
+		float y = std::max((int16_t)inY[i] * (1.0f / 32767.0f), -1.0f);
+		float z = 1.0f - fabsf(x) - fabsf(y);
+		float t = std::max(-z, 0.0f);
+
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+		out[i] = glm::vec3(x * invLength, y * invLength, z * invLength);
+	}
+}
+
+
+template<typename T>
+void appendPlane(std::vector<unsigned char>& out, const std::vector<T>& plane) {
+	const unsigned char* bytes = (const unsigned char*)plane.data();
+	out.insert(out.end(), bytes, bytes + plane.size() * sizeof(T));
+}
@@ -0,0 +1,39 @@
+#ifndef MESHCODEC_H
+#define MESHCODEC_H
+
+#include <vector>
+#include <cstdint>
+
+#include "Mesh.h"
+
+
+///////////////////////////////////////////////////
+// Mesh Compression Codec
+// Vertices are quantized and de-duplicated, then stored as separate planes:
+//   positions - 3 x unorm16 relative to the mesh AABB
+//   normals   - 2 x snorm16 octahedral encoding
+//   uvs       - 2 x unorm16 relative to the uv bounds
+//   indices   - delta + zigzag + varint bytes, rANS entropy coded with four
+//               interleaved states sharing one byte stream
+// Decoding dequantizes whole planes at a time (SSE2 where available) straight
+// into the VecData layout and always produces indexed VecData.
+
+struct CodecError {
+	float maxPositionError = 0.0f;	// world units
+	float maxNormalError = 0.0f;	// degrees
+	float maxUvError = 0.0f;
+	bool sizesMatch = true;
+};
+
+
+std::vector<unsigned char> encodeVecData(const VecData& vecData);
+bool decodeVecData(const unsigned char* data, size_t size, VecData& vecData);
+
+// compares decoded data against the original vertex data
+CodecError measureCodecError(const VecData& original, const VecData& decoded);
+
+// round trips the index entropy coder over adversarial byte distributions (ModelConverter --self-test),
+// prints each failure and returns false if there were any
+bool testEntropyCoder();
+
+#endif
@@ -0,0 +1,617 @@
+#include "MeshProcessing.h"
+#include "Hash.h"
+
+#include <cmath>
+#include <cfloat>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+
+///////////////////////////////////////////////////
+// DataTypes
+struct VertexKey {
+	float values[8]; // position xyz, normal xyz, uv xy
+
+	bool operator==(const VertexKey& other) const {
+		return memcmp(values, other.values, sizeof(values)) == 0;
+	}
+};
+
+struct VertexKeyHash {
+	size_t operator()(const VertexKey& key) const {
+		return (size_t)hashBytes(key.values, sizeof(key.values));
+	}
+};
+
+// Uniform grid over the triangle centres of a mesh, emitted triangles are removed as meshlets grow
+struct TriangleGrid {
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 cellSize = glm::vec3(1.0f);
+	int dims[3] = { 1, 1, 1 };
+	float minCellSize = FLT_MAX;			// smallest cell side along the axes that are split
+
+	std::vector<unsigned int> cellStarts;	// first slot of each cell
+	std::vector<unsigned int> cellCounts;	// triangles still in each cell, packed from its first slot
+	std::vector<unsigned int> slots;		// triangles grouped by cell
+	std::vector<unsigned int> triangleSlots;
+	std::vector<unsigned int> triangleCells;
+};
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+void finishBounds(const VecData& vecData, MeshBounds& bounds);
+void finishMeshlet(const VecData& vecData, const std::vector<unsigned int>& indices, bool useCone, Meshlet& meshlet);
+bool isClosed(const VecData& vecData);
+glm::vec3 getTriangleCentre(const VecData& vecData, unsigned int triangle);
+void buildTriangleGrid(const std::vector<glm::vec3>& centres, TriangleGrid& grid);
+void removeFromGrid(TriangleGrid& grid, unsigned int triangle);
+unsigned int findNearestTriangle(const TriangleGrid& grid, const std::vector<glm::vec3>& centres, glm::vec3 point);
+bool canBatch(const Mesh& a, const Mesh& b);
+Mesh mergeMeshes(const std::vector<Mesh*>& group);
+void appendIndices(std::vector<unsigned int>& indices, const std::vector<unsigned int>& source, unsigned int baseVertex);
+
+
+///////////////////////////////////////////////////
+// Global Vars
+const float MIN_CONE_DOT = 0.1f; // normal cones wider than about 84 degrees either side can never face away entirely
+
+
+void indexVecData(VecData& vecData, MeshBounds& bounds) {
+	if (!vecData.indices.empty() || vecData.vertices.empty()) {
+		bounds = computeBounds(vecData);
+		return;
+	}
+
+	size_t numVertices = vecData.vertices.size();
+	bool hasNormals = vecData.normals.size() == numVertices;
+	bool hasUvs = vecData.uvs.size() == numVertices;	// attributes that do not cover every vertex are dropped
+
+	std::unordered_map<VertexKey, unsigned int, VertexKeyHash> vertexLookup;
+	vertexLookup.reserve(numVertices);
+
+	VecData indexed;
+	indexed.materialName = vecData.materialName;
+	indexed.indices.reserve(numVertices);
+
+	bounds.min = bounds.max = vecData.vertices[0];
+
+	for (size_t i = 0; i < numVertices; i++) {
+		VertexKey key;
+		memset(&key, 0, sizeof(key));
+
+		memcpy(&key.values[0], &vecData.vertices[i], sizeof(glm::vec3));
+		if (hasNormals)
+			memcpy(&key.values[3], &vecData.normals[i], sizeof(glm::vec3));
+		if (hasUvs)
+			memcpy(&key.values[6], &vecData.uvs[i], sizeof(glm::vec2));
+
+		auto found = vertexLookup.find(key);
+		if (found != vertexLookup.end()) {
+			indexed.indices.push_back(found->second);
+			continue;
+		}
+
+		unsigned int index = (unsigned int)indexed.vertices.size();
+		vertexLookup[key] = index;
+		indexed.indices.push_back(index);
+
+		indexed.vertices.push_back(vecData.vertices[i]);
+		bounds.min = glm::min(bounds.min, vecData.vertices[i]);
+		bounds.max = glm::max(bounds.max, vecData.vertices[i]);
+
+		if (hasNormals)
+			indexed.normals.push_back(vecData.normals[i]);
+		if (hasUvs)
+			indexed.uvs.push_back(vecData.uvs[i]);
+	}
+
+	vecData = indexed;
+
+	finishBounds(vecData, bounds);
+}
+
+MeshBounds computeBounds(const VecData& vecData) {
+	MeshBounds bounds;
+	if (vecData.vertices.empty())
+		return bounds;
+
+	bounds.min = bounds.max = vecData.vertices[0];
+	for (unsigned int i = 1; i < vecData.vertices.size(); i++) {
+		bounds.min = glm::min(bounds.min, vecData.vertices[i]);
+		bounds.max = glm::max(bounds.max, vecData.vertices[i]);
+	}
+
+	finishBounds(vecData, bounds);
+
+	return bounds;
+}
+
+void buildMeshlets(VecData& vecData, std::vector<Meshlet>& meshlets) {
+	meshlets.clear();
+
+	size_t numTriangles = vecData.indices.size() / 3;
+	size_t numVertices = vecData.vertices.size();
+
+	if (numTriangles <= MAX_MESHLET_TRIANGLES)
+		return;
+
+	///////////////////////////////////////////////////
+	// Triangles around each vertex
+	std::vector<unsigned int> triangleOffsets(numVertices + 1, 0);
+	std::vector<unsigned int> triangleLists(vecData.indices.size());
+
+	for (size_t i = 0; i < vecData.indices.size(); i++)
+		triangleOffsets[vecData.indices[i] + 1]++;
+
+	for (size_t i = 1; i <= numVertices; i++)
+		triangleOffsets[i] += triangleOffsets[i - 1];
+
+	std::vector<unsigned int> counts(numVertices, 0);
+	for (size_t i = 0; i < vecData.indices.size(); i++) {
+		unsigned int vertex = vecData.indices[i];
+		triangleLists[triangleOffsets[vertex] + counts[vertex]++] = (unsigned int)(i / 3);
+	}
+
+	// normal cones are only used where back faces are never seen, and oriented by the vertex normals
+	bool useCones = vecData.normals.size() == numVertices && isClosed(vecData);
+
+	std::vector<glm::vec3> centres(numTriangles);
+	for (size_t i = 0; i < numTriangles; i++)
+		centres[i] = getTriangleCentre(vecData, (unsigned int)i);
+
+	TriangleGrid grid;
+	buildTriangleGrid(centres, grid);
+
+	///////////////////////////////////////////////////
+	// Grow each meshlet from the first triangle left, always adding the neighbour
+	// with the fewest new vertices and then the one nearest the meshlet centre.
+	// When no neighbour is left, the meshlet carries on from the nearest triangle left anywhere
+	std::vector<bool> emitted(numTriangles, false);
+	std::vector<unsigned int> vertexMeshlet(numVertices, UINT_MAX);
+	std::vector<unsigned int> candidateMeshlet(numTriangles, UINT_MAX);	// each triangle is a candidate of a meshlet once
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> indices;
+	indices.reserve(vecData.indices.size());
+
+	unsigned int seed = 0;
+
+	while (indices.size() < vecData.indices.size()) {
+		while (emitted[seed])
+			seed++;
+
+		unsigned int id = (unsigned int)meshlets.size();
+		unsigned int numMeshletVertices = 0;
+		glm::vec3 centreTotal = glm::vec3(0.0f);
+
+		Meshlet meshlet;
+		meshlet.firstIndex = (unsigned int)indices.size();
+		candidates.assign(1, seed);
+		candidateMeshlet[seed] = id;
+
+		while (meshlet.triangleCount < MAX_MESHLET_TRIANGLES) {
+			glm::vec3 centre = meshlet.triangleCount > 0 ? centreTotal / (float)meshlet.triangleCount : centres[seed];
+
+			// a triangle away from the meshlet needs at most three new vertices
+			if (candidates.empty() && numMeshletVertices + 3 <= MAX_MESHLET_VERTICES) {
+				unsigned int nearest = findNearestTriangle(grid, centres, centre);
+				if (nearest == UINT_MAX)
+					break;
+
+				candidates.push_back(nearest);
+				candidateMeshlet[nearest] = id;
+			}
+
+			unsigned int best = UINT_MAX, bestNewVertices = 4;
+			size_t bestCandidate = 0;
+			float bestDistance = FLT_MAX;
+
+			for (size_t c = 0; c < candidates.size(); c++) {
+				unsigned int triangle = candidates[c];
+				unsigned int newVertices = 0;
+				for (unsigned int k = 0; k < 3; k++)
+					newVertices += vertexMeshlet[vecData.indices[triangle * 3 + k]] != id;
+
+				if (numMeshletVertices + newVertices > MAX_MESHLET_VERTICES)
+					continue;
+
+				glm::vec3 offset = centres[triangle] - centre;
+				float distance = glm::dot(offset, offset);
+
+				if (newVertices < bestNewVertices || (newVertices == bestNewVertices && distance < bestDistance)) {
+					best = triangle;
+					bestCandidate = c;
+					bestNewVertices = newVertices;
+					bestDistance = distance;
+				}
+			}
+
+			if (best == UINT_MAX)
+				break;
+
+			candidates[bestCandidate] = candidates.back();
+			candidates.pop_back();
+
+			emitted[best] = true;
+			removeFromGrid(grid, best);
+			centreTotal += centres[best];
+			meshlet.triangleCount++;
+
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int vertex = vecData.indices[best * 3 + k];
+				indices.push_back(vertex);
+
+				if (vertexMeshlet[vertex] != id) {
+					vertexMeshlet[vertex] = id;
+					numMeshletVertices++;
+				}
+
+				for (unsigned int j = triangleOffsets[vertex]; j < triangleOffsets[vertex + 1]; j++) {
+					unsigned int triangle = triangleLists[j];
+					if (!emitted[triangle] && candidateMeshlet[triangle] != id) {
+						candidateMeshlet[triangle] = id;
+						candidates.push_back(triangle);
+					}
+				}
+			}
+		}
+
+		finishMeshlet(vecData, indices, useCones, meshlet);
+		meshlets.push_back(meshlet);
+	}
+
+	vecData.indices = indices;
+}
+
+void batchMeshes(std::vector<Mesh>& meshes) {
+	std::vector<Mesh> batched;
+	std::vector<bool> merged(meshes.size(), false);
+
+	// each batch takes the place of its first mesh
+	for (size_t i = 0; i < meshes.size(); i++) {
+		if (merged[i])
+			continue;
+
+		std::vector<Mesh*> group(1, &meshes[i]);
+		for (size_t j = i + 1; j < meshes.size(); j++) {
+			if (!merged[j] && canBatch(meshes[i], meshes[j])) {
+				group.push_back(&meshes[j]);
+				merged[j] = true;
+			}
+		}
+
+		if (group.size() > 1)
+			batched.push_back(mergeMeshes(group));
+		else
+			batched.push_back(std::move(meshes[i]));
+	}
+
+	meshes.swap(batched);
+}
+
+// centres the sphere on the box, the radius only reaches the furthest vertex (tighter than the box corners)
+void finishBounds(const VecData& vecData, MeshBounds& bounds) {
+	bounds.centre = (bounds.min + bounds.max) * 0.5f;
+
+	float radiusSquared = 0.0f;
+	for (unsigned int i = 0; i < vecData.vertices.size(); i++) {
+		glm::vec3 offset = vecData.vertices[i] - bounds.centre;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+
+	bounds.radius = sqrtf(radiusSquared);
+}
+
+// bounding sphere around the box centre and the cone around the triangle facings
+void finishMeshlet(const VecData& vecData, const std::vector<unsigned int>& indices, bool useCone, Meshlet& meshlet) {
+	unsigned int first = meshlet.firstIndex, last = meshlet.firstIndex + meshlet.triangleCount * 3;
+
+	glm::vec3 min = vecData.vertices[indices[first]], max = min;
+	for (unsigned int i = first; i < last; i++) {
+		min = glm::min(min, vecData.vertices[indices[i]]);
+		max = glm::max(max, vecData.vertices[indices[i]]);
+	}
+
+	meshlet.centre = (min + max) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (unsigned int i = first; i < last; i++)
+		meshlet.radius = std::max(meshlet.radius, glm::length(vecData.vertices[indices[i]] - meshlet.centre));
+
+	meshlet.coneAxis = glm::vec3(0.0f);
+	meshlet.coneCutoff = 1.0f;
+	if (!useCone)
+		return;
+
+	// facings point the same way as the vertex normals, whatever the winding
+	std::vector<glm::vec3> facings;
+	glm::vec3 facingTotal = glm::vec3(0.0f);
+
+	for (unsigned int i = first; i < last; i += 3) {
+		glm::vec3 a = vecData.vertices[indices[i]], b = vecData.vertices[indices[i + 1]], c = vecData.vertices[indices[i + 2]];
+		glm::vec3 facing = glm::cross(b - a, c - a);
+		float length = glm::length(facing);
+
+		if (length == 0.0f)
+			continue;
+
+		facing /= length;
+		if (glm::dot(facing, vecData.normals[indices[i]] + vecData.normals[indices[i + 1]] + vecData.normals[indices[i + 2]]) < 0.0f)
+			facing = -facing;
+
+		facings.push_back(facing);
+		facingTotal += facing;
+	}
+
+	if (glm::length(facingTotal) == 0.0f)
+		return;
+
+	glm::vec3 axis = glm::normalize(facingTotal);
+	float minDot = 1.0f;
+	for (const glm::vec3& facing : facings)
+		minDot = std::min(minDot, glm::dot(axis, facing));
+
+	if (minDot <= MIN_CONE_DOT)
+		return;
+
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+// every edge between distinct positions is shared by exactly two triangles
+bool isClosed(const VecData& vecData) {
+	std::unordered_map<VertexKey, unsigned int, VertexKeyHash> positionLookup;
+	std::vector<unsigned int> positionIds(vecData.vertices.size());
+
+	for (size_t i = 0; i < vecData.vertices.size(); i++) {
+		// adding zero turns -0 into 0, seams are often written with both
+		glm::vec3 position = vecData.vertices[i] + glm::vec3(0.0f);
+
+		VertexKey key;
+		memset(&key, 0, sizeof(key));
+		memcpy(&key.values[0], &position, sizeof(glm::vec3));
+
+		auto found = positionLookup.find(key);
+		if (found == positionLookup.end())
+			found = positionLookup.insert(std::make_pair(key, (unsigned int)positionLookup.size())).first;
+
+		positionIds[i] = found->second;
+	}
+
+	std::unordered_map<uint64_t, unsigned int> edgeUses;
+
+	for (size_t i = 0; i < vecData.indices.size(); i += 3) {
+		uint64_t ids[3] = { positionIds[vecData.indices[i]], positionIds[vecData.indices[i + 1]], positionIds[vecData.indices[i + 2]] };
+
+		// zero area triangles (a pole of a uv sphere) close nothing
+		if (ids[0] == ids[1] || ids[1] == ids[2] || ids[2] == ids[0])
+			continue;
+
+		for (int k = 0; k < 3; k++)
+			edgeUses[std::min(ids[k], ids[(k + 1) % 3]) << 32 | std::max(ids[k], ids[(k + 1) % 3])]++;
+	}
+
+	for (auto& edge : edgeUses) {
+		if (edge.second != 2)
+			return false;
+	}
+
+	return !edgeUses.empty();
+}
+
+glm::vec3 getTriangleCentre(const VecData& vecData, unsigned int triangle) {
+	const unsigned int* corners = &vecData.indices[triangle * 3];
+	return (vecData.vertices[corners[0]] + vecData.vertices[corners[1]] + vecData.vertices[corners[2]]) / 3.0f;
+}
+
+// about one triangle per cell, flat axes are not split
+void buildTriangleGrid(const std::vector<glm::vec3>& centres, TriangleGrid& grid) {
+	glm::vec3 max = centres[0];
+	grid.min = centres[0];
+	for (size_t i = 1; i < centres.size(); i++) {
+		grid.min = glm::min(grid.min, centres[i]);
+		max = glm::max(max, centres[i]);
+	}
+
+	glm::vec3 extent = max - grid.min;
+	float largest = std::max(extent.x, std::max(extent.y, extent.z));
+
+	int splitAxes = 0;
+	for (int axis = 0; axis < 3; axis++)
+		splitAxes += extent[axis] > largest * 1e-4f;
+
+	int cellsPerAxis = splitAxes > 0 ? (int)std::pow((float)centres.size(), 1.0f / splitAxes) : 1;
+	cellsPerAxis = std::max(1, std::min(cellsPerAxis, 64));
+
+	for (int axis = 0; axis < 3; axis++) {
+		bool split = extent[axis] > largest * 1e-4f;
+		grid.dims[axis] = split ? cellsPerAxis : 1;
+		grid.cellSize[axis] = split ? extent[axis] / grid.dims[axis] : std::max(largest, 1.0f);
+
+		if (grid.dims[axis] > 1)
+			grid.minCellSize = std::min(grid.minCellSize, grid.cellSize[axis]);
+	}
+
+	size_t numCells = (size_t)grid.dims[0] * grid.dims[1] * grid.dims[2];
+	grid.cellStarts.assign(numCells + 1, 0);
+	grid.cellCounts.assign(numCells, 0);
+	grid.slots.resize(centres.size());
+	grid.triangleSlots.resize(centres.size());
+	grid.triangleCells.resize(centres.size());
+
+	for (size_t i = 0; i < centres.size(); i++) {
+		glm::vec3 cell = (centres[i] - grid.min) / grid.cellSize;
+		int x = std::min((int)cell.x, grid.dims[0] - 1);
+		int y = std::min((int)cell.y, grid.dims[1] - 1);
+		int z = std::min((int)cell.z, grid.dims[2] - 1);
+
+		grid.triangleCells[i] = (unsigned int)((z * grid.dims[1] + y) * grid.dims[0] + x);
+		grid.cellStarts[grid.triangleCells[i] + 1]++;
+	}
+
+	for (size_t c = 1; c <= numCells; c++)
+		grid.cellStarts[c] += grid.cellStarts[c - 1];
+
+	for (size_t i = 0; i < centres.size(); i++) {
+		unsigned int cell = grid.triangleCells[i];
+		unsigned int slot = grid.cellStarts[cell] + grid.cellCounts[cell]++;
+		grid.slots[slot] = (unsigned int)i;
+		grid.triangleSlots[i] = slot;
+	}
+}
+
+void removeFromGrid(TriangleGrid& grid, unsigned int triangle) {
+	unsigned int cell = grid.triangleCells[triangle];
+	unsigned int slot = grid.triangleSlots[triangle];
+	unsigned int last = grid.cellStarts[cell] + --grid.cellCounts[cell];
+
+	// the last triangle of the cell takes the free slot
+	unsigned int moved = grid.slots[last];
+	grid.slots[slot] = moved;
+	grid.triangleSlots[moved] = slot;
+}
+
+// searches the cells in growing shells around the point, until no closer triangle can be left
+unsigned int findNearestTriangle(const TriangleGrid& grid, const std::vector<glm::vec3>& centres, glm::vec3 point) {
+	glm::vec3 cell = (point - grid.min) / grid.cellSize;
+	int centre[3];
+	for (int axis = 0; axis < 3; axis++)
+		centre[axis] = (int)std::max(0.0f, std::min(std::floor(cell[axis]), grid.dims[axis] - 1.0f));
+
+	int maxRadius = std::max(grid.dims[0], std::max(grid.dims[1], grid.dims[2]));
+	unsigned int best = UINT_MAX;
+	float bestDistance = FLT_MAX;
+
+	for (int radius = 0; radius < maxRadius; radius++) {
+		for (int dz = -radius; dz <= radius; dz++) {
+			int z = centre[2] + dz;
+			if (z < 0 || z >= grid.dims[2])
+				continue;
+
+			for (int dy = -radius; dy <= radius; dy++) {
+				int y = centre[1] + dy;
+				if (y < 0 || y >= grid.dims[1])
+					continue;
+
+				// inside the shell only its two x faces are new
+				bool onFace = std::abs(dz) == radius || std::abs(dy) == radius;
+				int step = onFace || radius == 0 ? 1 : radius * 2;
+
+				for (int dx = -radius; dx <= radius; dx += step) {
+					int x = centre[0] + dx;
+					if (x < 0 || x >= grid.dims[0])
+						continue;
+
+					unsigned int c = (unsigned int)((z * grid.dims[1] + y) * grid.dims[0] + x);
+					for (unsigned int s = grid.cellStarts[c]; s < grid.cellStarts[c] + grid.cellCounts[c]; s++) {
+						glm::vec3 offset = centres[grid.slots[s]] - point;
+						float distance = glm::dot(offset, offset);
+
+						if (distance < bestDistance) {
+							best = grid.slots[s];
+							bestDistance = distance;
+						}
+					}
+				}
+			}
+		}
+
+		// anything in the next shell is at least radius cells away
+		float reach = radius * grid.minCellSize;
+		if (best != UINT_MAX && bestDistance <= reach * reach)
+			break;
+	}
+
+	return best;
+}
+
+// the same material and textures (textures are found relative to the mesh path) and the same vertex attributes
+bool canBatch(const Mesh& a, const Mesh& b) {
+	if (a.isBlended() || b.isBlended() || a.vecData.indices.empty() || b.vecData.indices.empty())
+		return false;
+
+	bool sameAttributes = (a.vecData.normals.size() == a.vecData.vertices.size()) == (b.vecData.normals.size() == b.vecData.vertices.size())
+		&& (a.vecData.uvs.size() == a.vecData.vertices.size()) == (b.vecData.uvs.size() == b.vecData.vertices.size());
+
+	const MtlData& x = a.mtlData;
+	const MtlData& y = b.mtlData;
+
+	return sameAttributes && a.meshType == b.meshType && a.path == b.path
+		&& x.materialName == y.materialName && x.Ns == y.Ns && x.Ka == y.Ka && x.Kd == y.Kd && x.Ks == y.Ks && x.Ke == y.Ke
+		&& x.Ni == y.Ni && x.d == y.d && x.illum == y.illum && x.map_d == y.map_d && x.map_Kd == y.map_Kd;
+}
+
+Mesh mergeMeshes(const std::vector<Mesh*>& group) {
+	Mesh batch;
+	batch.meshType = group[0]->meshType;
+	batch.path = group[0]->path;
+	batch.mtlData = group[0]->mtlData;
+	batch.vecData.materialName = group[0]->vecData.materialName;
+
+	bool hasNormals = group[0]->vecData.normals.size() == group[0]->vecData.vertices.size();
+	bool hasUvs = group[0]->vecData.uvs.size() == group[0]->vecData.vertices.size();
+
+	size_t numLevels = 1;
+	for (Mesh* mesh : group)
+		numLevels = std::max(numLevels, mesh->lods.size() + 1);
+	batch.lods.resize(numLevels - 1);
+
+	for (Mesh* mesh : group) {
+		const VecData& source = mesh->vecData;
+		VecData& vecData = batch.vecData;
+		unsigned int baseVertex = (unsigned int)vecData.vertices.size();
+
+		MeshPart part;
+		part.firstIndex = (unsigned int)vecData.indices.size();
+		part.triangleCount = (unsigned int)(source.indices.size() / 3);
+		part.bounds = mesh->bounds;
+		batch.parts.push_back(part);
+
+		vecData.vertices.insert(vecData.vertices.end(), source.vertices.begin(), source.vertices.end());
+		if (hasNormals)
+			vecData.normals.insert(vecData.normals.end(), source.normals.begin(), source.normals.end());
+		if (hasUvs)
+			vecData.uvs.insert(vecData.uvs.end(), source.uvs.begin(), source.uvs.end());
+		appendIndices(vecData.indices, source.indices, baseVertex);
+
+		///////////////////////////////////////////////////
+		// Meshlets move with their part, a part that fits in one becomes one
+		if (mesh->meshlets.empty()) {
+			Meshlet meshlet;
+			meshlet.firstIndex = part.firstIndex;
+			meshlet.triangleCount = part.triangleCount;
+			finishMeshlet(vecData, vecData.indices, hasNormals && isClosed(source), meshlet);
+			batch.meshlets.push_back(meshlet);
+		}
+
+		for (Meshlet meshlet : mesh->meshlets) {
+			meshlet.firstIndex += part.firstIndex;
+			batch.meshlets.push_back(meshlet);
+		}
+
+		// parts with a shorter chain repeat their coarsest level
+		for (size_t level = 1; level < numLevels; level++) {
+			size_t partLevel = std::min(level, mesh->lods.size());
+			MeshLod& lod = batch.lods[level - 1];
+
+			if (partLevel == 0) {
+				appendIndices(lod.indices, source.indices, baseVertex);
+				continue;
+			}
+
+			appendIndices(lod.indices, mesh->lods[partLevel - 1].indices, baseVertex);
+			lod.error = std::max(lod.error, mesh->lods[partLevel - 1].error);
+		}
+	}
+
+	batch.bounds = computeBounds(batch.vecData);
+
+	return batch;
+}
+
+void appendIndices(std::vector<unsigned int>& indices, const std::vector<unsigned int>& source, unsigned int baseVertex) {
+	indices.reserve(indices.size() + source.size());
+	for (unsigned int index : source)
+		indices.push_back(index + baseVertex);
+}
@@ -0,0 +1,28 @@
+#ifndef MESHPROCESSING_H
+#define MESHPROCESSING_H
+
+#include "Mesh.h"
+
+
+///////////////////////////////////////////////////
+// Mesh Processing
+// Offline steps run on imported VecData before it is cached or uploaded.
+
+// merges identical vertices (position, normal and uv) and fills vecData.indices,
+// the bounds are gathered in the same pass
+void indexVecData(VecData& vecData, MeshBounds& bounds);
+
+// box around the vertices and the smallest sphere around the box centre containing them
+MeshBounds computeBounds(const VecData& vecData);
+
+// reorders the triangles of an indexed mesh into clusters of neighbours (at most MAX_MESHLET_VERTICES
+// and MAX_MESHLET_TRIANGLES each) with their bounding spheres and normal cones, meshes fitting in one are left alone
+void buildMeshlets(VecData& vecData, std::vector<Meshlet>& meshlets);
+
+// merges the indexed meshes sharing a material, textures and vertex attributes into one mesh each
+// (blended meshes are left alone, they are sorted back to front one by one). Each merged mesh
+// keeps its source meshes as parts, and its meshlets never cross a part, so every part can
+// still be culled on its own. Levels of detail are merged level by level.
+void batchMeshes(std::vector<Mesh>& meshes);
+
+#endif
@@ -0,0 +1,486 @@
+#include "MeshSimplifier.h"
+#include "Hash.h"
+
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+#include <climits>
+#include <algorithm>
+#include <unordered_map>
+
+
+///////////////////////////////////////////////////
+// DataTypes
+// Area weighted sum of squared distances to a set of planes (symmetric 4x4 matrix)
+struct Quadric {
+	double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+	double b2 = 0.0, bc = 0.0, bd = 0.0;
+	double c2 = 0.0, cd = 0.0;
+	double d2 = 0.0;
+	double weight = 0.0;
+
+	void addPlane(double a, double b, double c, double d, double area);
+	void add(const Quadric& other);
+
+	// mean squared distance of a point to the planes, so merged quadrics stay in distance units
+	double evaluate(const glm::vec3& p) const;
+};
+
+struct Collapse {
+	unsigned int from;	// position group moved onto to
+	unsigned int to;
+	double cost;
+};
+
+struct PositionKey {
+	glm::vec3 position;
+
+	bool operator==(const PositionKey& other) const {
+		return memcmp(&position, &other.position, sizeof(glm::vec3)) == 0;
+	}
+};
+
+struct PositionKeyHash {
+	size_t operator()(const PositionKey& key) const {
+		return (size_t)hashBytes(&key.position, sizeof(glm::vec3));
+	}
+};
+
+// Vertices are grouped by position (wedges of a group differ in normal or uv),
+// a group is named after its first vertex
+class QuadricSimplifier {
+public:
+	explicit QuadricSimplifier(const VecData& vecData);
+
+	// collapses until the index count reaches the target or no collapse under errorLimit is left
+	void simplify(size_t targetIndexCount, float errorLimit);
+
+	const std::vector<unsigned int>& getIndices() const { return indices; }
+
+	// largest error of a collapse so far, as a distance (root mean square to the planes the vertex has gathered)
+	float getError() const { return (float)sqrt(maxError); }
+private:
+	const std::vector<glm::vec3>& positions;
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> wedgeGroup;	// vertex -> group
+	std::vector<unsigned int> nextWedge;	// circular list of the vertices in a group
+	std::vector<bool> locked;				// by group
+	std::vector<Quadric> quadrics;			// by group
+	double maxError = 0.0;
+
+	// triangles around each group, rebuilt every pass
+	std::vector<unsigned int> triangleOffsets;
+	std::vector<unsigned int> triangleLists;
+
+	std::vector<std::pair<unsigned int, unsigned int>> wedgeMap; // vertex of the moved group -> vertex it becomes
+	std::vector<unsigned int> fromNeighbours, toNeighbours;
+
+	void buildAdjacency();
+	bool canCollapse(unsigned int from, unsigned int to);
+	void getNeighbours(unsigned int group, unsigned int other, std::vector<unsigned int>& neighbours) const;
+	unsigned int getGroup(unsigned int triangle, unsigned int corner) const { return wedgeGroup[indices[triangle * 3 + corner]]; }
+};
+
+
+///////////////////////////////////////////////////
+// Global Vars
+const size_t MIN_LOD_TRIANGLES = 32;	// meshes and levels smaller than this are not simplified further
+const float MIN_LOD_REDUCTION = 0.75f;	// a level keeping more of the previous triangles is dropped
+const float MAX_LOD_ERROR = 0.1f;		// largest error of a collapse, relative to the size of the mesh
+
+
+void generateLods(const VecData& vecData, std::vector<MeshLod>& lods) {
+	lods.clear();
+
+	if (vecData.indices.size() < MIN_LOD_TRIANGLES * 3)
+		return;
+
+	glm::vec3 min = vecData.vertices[0], max = vecData.vertices[0];
+	for (const glm::vec3& position : vecData.vertices) {
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+
+	// past this the shape itself is lost, such a level would only ever be drawn below a pixel
+	float errorLimit = glm::length(max - min) * 0.5f * MAX_LOD_ERROR;
+
+	QuadricSimplifier simplifier(vecData);
+	size_t previousCount = vecData.indices.size();
+
+	// every level continues from the one before, so the errors only grow. The first
+	// MIN_LODS levels only need to remove triangles, the error limit still applies to them
+	for (unsigned int level = 1; level < MAX_LODS; level++) {
+		bool required = level < MIN_LODS;
+
+		if (!required && previousCount < MIN_LOD_TRIANGLES * 3)
+			break;
+
+		simplifier.simplify(previousCount / 6 * 3, errorLimit);
+
+		size_t count = simplifier.getIndices().size();
+		if (count == 0 || count >= previousCount || (!required && count > previousCount * MIN_LOD_REDUCTION))
+			break;
+
+		MeshLod lod;
+		lod.indices = simplifier.getIndices();
+		lod.error = simplifier.getError();
+		lods.push_back(lod);
+
+		previousCount = count;
+	}
+}
+
+
+QuadricSimplifier::QuadricSimplifier(const VecData& vecData) : positions(vecData.vertices), indices(vecData.indices) {
+	size_t numVertices = positions.size();
+
+	///////////////////////////////////////////////////
+	// Group the vertices sharing a position
+	wedgeGroup.resize(numVertices);
+	nextWedge.resize(numVertices);
+
+	std::unordered_map<PositionKey, unsigned int, PositionKeyHash> groupLookup;
+	groupLookup.reserve(numVertices);
+
+	for (unsigned int i = 0; i < numVertices; i++) {
+		PositionKey key;
+		key.position = positions[i];
+
+		auto found = groupLookup.find(key);
+		if (found == groupLookup.end()) {
+			groupLookup[key] = i;
+			wedgeGroup[i] = i;
+			nextWedge[i] = i;
+		}
+		else {
+			unsigned int group = found->second;
+			wedgeGroup[i] = group;
+			nextWedge[i] = nextWedge[group];
+			nextWedge[group] = i;
+		}
+	}
+
+	///////////////////////////////////////////////////
+	// Planes of the triangles around each position
+	quadrics.assign(numVertices, Quadric());
+	locked.assign(numVertices, false);
+
+	std::unordered_map<uint64_t, unsigned int> edgeUses;
+
+	for (size_t t = 0; t < indices.size() / 3; t++) {
+		unsigned int groups[3] = { getGroup(t, 0), getGroup(t, 1), getGroup(t, 2) };
+
+		glm::vec3 normal = glm::cross(positions[groups[1]] - positions[groups[0]], positions[groups[2]] - positions[groups[0]]);
+		float length = glm::length(normal);
+
+		if (length > 0.0f) {
+			normal /= length;
+			double distance = -glm::dot(normal, positions[groups[0]]);
+
+			for (int k = 0; k < 3; k++)
+				quadrics[groups[k]].addPlane(normal.x, normal.y, normal.z, distance, length * 0.5);
+		}
+
+		for (int k = 0; k < 3; k++) {
+			uint64_t a = std::min(groups[k], groups[(k + 1) % 3]);
+			uint64_t b = std::max(groups[k], groups[(k + 1) % 3]);
+			edgeUses[a << 32 | b]++;
+		}
+	}
+
+	// open (or non-manifold) edges keep their vertices, material borders are open edges of the mesh
+	for (auto& edge : edgeUses) {
+		if (edge.second != 2) {
+			locked[(unsigned int)(edge.first >> 32)] = true;
+			locked[(unsigned int)(edge.first & 0xFFFFFFFF)] = true;
+		}
+	}
+
+	// so do UV seams, a group with two texture coordinates would tear if it moved
+	if (vecData.uvs.size() == numVertices) {
+		for (unsigned int i = 0; i < numVertices; i++) {
+			if (vecData.uvs[i] != vecData.uvs[wedgeGroup[i]])
+				locked[wedgeGroup[i]] = true;
+		}
+	}
+}
+
+void QuadricSimplifier::simplify(size_t targetIndexCount, float errorLimit) {
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> remap(positions.size());
+	std::vector<bool> touched;
+
+	while (indices.size() > targetIndexCount) {
+		buildAdjacency();
+
+		///////////////////////////////////////////////////
+		// Every edge once, in the direction adding less error
+		// (the edge between two triangles is seen forwards from one and backwards from the other)
+		collapses.clear();
+
+		for (size_t t = 0; t < indices.size() / 3; t++) {
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int a = getGroup(t, k);
+				unsigned int b = getGroup(t, (k + 1) % 3);
+
+				if (a > b || (locked[a] && locked[b]))
+					continue;
+
+				Quadric merged = quadrics[a];
+				merged.add(quadrics[b]);
+
+				Collapse collapse;
+				double costAToB = locked[a] ? DBL_MAX : merged.evaluate(positions[b]);
+				double costBToA = locked[b] ? DBL_MAX : merged.evaluate(positions[a]);
+
+				collapse.from = costAToB <= costBToA ? a : b;
+				collapse.to = costAToB <= costBToA ? b : a;
+				collapse.cost = std::min(costAToB, costBToA);
+				collapses.push_back(collapse);
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			return a.cost != b.cost ? a.cost < b.cost : (a.from != b.from ? a.from < b.from : a.to < b.to);
+		});
+
+		///////////////////////////////////////////////////
+		// Cheapest first, the triangles around a collapse are left alone for the rest of the pass
+		for (unsigned int i = 0; i < remap.size(); i++)
+			remap[i] = i;
+		touched.assign(positions.size(), false);
+
+		size_t removedIndices = 0;
+		unsigned int numCollapses = 0;
+
+		for (const Collapse& collapse : collapses) {
+			if (indices.size() - removedIndices <= targetIndexCount || collapse.cost > (double)errorLimit * errorLimit)
+				break;
+
+			if (touched[collapse.from] || touched[collapse.to] || !canCollapse(collapse.from, collapse.to))
+				continue;
+
+			for (auto& mapped : wedgeMap)
+				remap[mapped.first] = mapped.second;
+
+			for (unsigned int j = triangleOffsets[collapse.from]; j < triangleOffsets[collapse.from + 1]; j++) {
+				unsigned int t = triangleLists[j];
+				bool collapsed = false;
+
+				for (unsigned int k = 0; k < 3; k++) {
+					touched[getGroup(t, k)] = true;
+					collapsed |= getGroup(t, k) == collapse.to;
+				}
+
+				if (collapsed)
+					removedIndices += 3;
+			}
+
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			maxError = std::max(maxError, collapse.cost);
+			numCollapses++;
+		}
+
+		if (numCollapses == 0)
+			return;
+
+		///////////////////////////////////////////////////
+		// Move the collapsed vertices and drop the triangles that closed up
+		size_t numIndices = 0;
+
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			unsigned int a = remap[indices[i]];
+			unsigned int b = remap[indices[i + 1]];
+			unsigned int c = remap[indices[i + 2]];
+
+			if (wedgeGroup[a] == wedgeGroup[b] || wedgeGroup[b] == wedgeGroup[c] || wedgeGroup[c] == wedgeGroup[a])
+				continue;
+
+			indices[numIndices++] = a;
+			indices[numIndices++] = b;
+			indices[numIndices++] = c;
+		}
+
+		indices.resize(numIndices);
+	}
+}
+
+
+void QuadricSimplifier::buildAdjacency() {
+	triangleOffsets.assign(positions.size() + 1, 0);
+
+	for (size_t i = 0; i < indices.size(); i++)
+		triangleOffsets[wedgeGroup[indices[i]] + 1]++;
+
+	for (size_t i = 1; i < triangleOffsets.size(); i++)
+		triangleOffsets[i] += triangleOffsets[i - 1];
+
+	triangleLists.resize(indices.size());
+	std::vector<unsigned int> counts(positions.size(), 0);
+
+	for (size_t i = 0; i < indices.size(); i++) {
+		unsigned int group = wedgeGroup[indices[i]];
+		triangleLists[triangleOffsets[group] + counts[group]++] = (unsigned int)(i / 3);
+	}
+}
+
+// fills wedgeMap, false if the collapse would flip a triangle
+bool QuadricSimplifier::canCollapse(unsigned int from, unsigned int to) {
+	wedgeMap.clear();
+	unsigned int fallback = UINT_MAX;
+
+	///////////////////////////////////////////////////
+	// Each vertex of the group follows an edge to a vertex of the target group, keeping its attributes continuous
+	// (vertices without such an edge only differ in normal, the group is not on a UV seam)
+	for (unsigned int j = triangleOffsets[from]; j < triangleOffsets[from + 1]; j++) {
+		unsigned int t = triangleLists[j];
+		unsigned int fromVertex = UINT_MAX, toVertex = UINT_MAX;
+
+		for (unsigned int k = 0; k < 3; k++) {
+			if (getGroup(t, k) == from)
+				fromVertex = indices[t * 3 + k];
+			else if (getGroup(t, k) == to)
+				toVertex = indices[t * 3 + k];
+		}
+
+		if (toVertex == UINT_MAX)
+			continue;
+
+		if (fallback == UINT_MAX)
+			fallback = toVertex;
+
+		bool mapped = false;
+		for (auto& existing : wedgeMap)
+			mapped |= existing.first == fromVertex;
+
+		if (!mapped)
+			wedgeMap.push_back(std::make_pair(fromVertex, toVertex));
+	}
+
+	if (fallback == UINT_MAX)
+		return false;
+
+	unsigned int vertex = from;
+	do {
+		bool mapped = false;
+		for (auto& existing : wedgeMap)
+			mapped |= existing.first == vertex;
+
+		if (!mapped)
+			wedgeMap.push_back(std::make_pair(vertex, fallback));
+
+		vertex = nextWedge[vertex];
+	} while (vertex != from);
+
+	///////////////////////////////////////////////////
+	// The triangles that stay must keep facing the same way
+	for (unsigned int j = triangleOffsets[from]; j < triangleOffsets[from + 1]; j++) {
+		unsigned int t = triangleLists[j];
+		glm::vec3 before[3], after[3];
+		bool collapsed = false;
+
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int group = getGroup(t, k);
+			collapsed |= group == to;
+
+			before[k] = positions[group];
+			after[k] = group == from ? positions[to] : positions[group];
+		}
+
+		if (collapsed)
+			continue;
+
+		glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+		glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+		// turning further than about 75 degrees folds the surface over its neighbours
+		if (glm::dot(normalBefore, normalAfter) < 0.25f * glm::length(normalBefore) * glm::length(normalAfter))
+			return false;
+	}
+
+	///////////////////////////////////////////////////
+	// The groups may only share the neighbours of the triangles between them,
+	// any other shared neighbour would pinch the surface into a fold (link condition)
+	unsigned int sharedTriangles = 0;
+	for (unsigned int j = triangleOffsets[from]; j < triangleOffsets[from + 1]; j++) {
+		unsigned int t = triangleLists[j];
+		if (getGroup(t, 0) == to || getGroup(t, 1) == to || getGroup(t, 2) == to)
+			sharedTriangles++;
+	}
+
+	getNeighbours(from, to, fromNeighbours);
+	getNeighbours(to, from, toNeighbours);
+
+	unsigned int sharedNeighbours = 0;
+	for (unsigned int i = 0, j = 0; i < fromNeighbours.size() && j < toNeighbours.size(); ) {
+		if (fromNeighbours[i] < toNeighbours[j])
+			i++;
+		else if (toNeighbours[j] < fromNeighbours[i])
+			j++;
+		else {
+			sharedNeighbours++;
+			i++;
+			j++;
+		}
+	}
+
+	return sharedNeighbours <= sharedTriangles;
+}
+
+// sorted groups sharing a triangle with the group, other than itself and other
+void QuadricSimplifier::getNeighbours(unsigned int group, unsigned int other, std::vector<unsigned int>& neighbours) const {
+	neighbours.clear();
+
+	for (unsigned int j = triangleOffsets[group]; j < triangleOffsets[group + 1]; j++) {
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int neighbour = getGroup(triangleLists[j], k);
+			if (neighbour != group && neighbour != other)
+				neighbours.push_back(neighbour);
+		}
+	}
+
+	std::sort(neighbours.begin(), neighbours.end());
+	neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+}
+
+
+void Quadric::addPlane(double a, double b, double c, double d, double area) {
+	a2 += area * a * a;
+	ab += area * a * b;
+	ac += area * a * c;
+	ad += area * a * d;
+	b2 += area * b * b;
+	bc += area * b * c;
+	bd += area * b * d;
+	c2 += area * c * c;
+	cd += area * c * d;
+	d2 += area * d * d;
+	weight += area;
+}
+
+void Quadric::add(const Quadric& other) {
+	a2 += other.a2;
+	ab += other.ab;
+	ac += other.ac;
+	ad += other.ad;
+	b2 += other.b2;
+	bc += other.bc;
+	bd += other.bd;
+	c2 += other.c2;
+	cd += other.cd;
+	d2 += other.d2;
+	weight += other.weight;
+}
+
+double Quadric::evaluate(const glm::vec3& p) const {
+	double x = p.x, y = p.y, z = p.z;
+	double error = a2 * x * x + b2 * y * y + c2 * z * z
+		+ 2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z)
+		+ d2;
+
+	if (weight <= 0.0)
+		return 0.0;
+
+	// rounding can take an exact fit slightly below zero
+	return std::max(error, 0.0) / weight;
+}
@@ -0,0 +1,20 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include "Mesh.h"
+
+
+///////////////////////////////////////////////////
+// Mesh Simplifier
+// Import time level of detail generation with the quadric error metric.
+// Vertices are collapsed onto a neighbour (half-edge collapse) in order of the
+// error they add, so every level only needs a new index list into the
+// vertices of the full mesh. Vertices sharing a position move together.
+// Vertices on open edges (the borders between materials, which are separate
+// meshes) and on UV seams are never moved, so neither can crack or tear.
+
+// fills lods with up to MAX_LODS - 1 levels, each targeting half the triangles of the one before.
+// Meshes of at least MIN_LOD_TRIANGLES get MIN_LODS - 1 levels unless no collapse is left within the error limit
+void generateLods(const VecData& vecData, std::vector<MeshLod>& lods);
+
+#endif
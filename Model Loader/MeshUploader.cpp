@@ -0,0 +1,37 @@
+#include "MeshUploader.h"
+
+#include <cstring>
+
+
+size_t MeshUploader::stage(const void* data, size_t size) {
+	// every block starts 4 byte aligned, as required for vertex attributes
+	size_t offset = (staging.size() + 3) & ~(size_t)3;
+
+	staging.resize(offset + size);
+	if (size > 0)
+		memcpy(&staging[offset], data, size);
+
+	return offset;
+}
+
+GLuint MeshUploader::upload() {
+	GLuint buffer = 0;
+
+	if (staging.empty())
+		return buffer;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, staging.size(), &staging[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	stats.bytes += staging.size();
+	stats.bufferAllocations += 1;
+	stats.bufferCopies += 1;
+	stats.glCalls += 4;
+
+	staging.clear();
+	staging.shrink_to_fit();
+
+	return buffer;
+}
@@ -0,0 +1,36 @@
+#ifndef MESHUPLOADER_H
+#define MESHUPLOADER_H
+
+#include <vector>
+#include <GL/glew.h>
+
+
+///////////////////////////////////////////////////
+// Mesh Uploader
+// Packs the vertex and index data of every mesh in a model into one staging
+// allocation, which is then copied into a single GL buffer with one call.
+// Meshes keep the byte offset of their data within that buffer.
+
+struct UploadStats {
+	size_t bytes = 0;
+	unsigned int bufferAllocations = 0;	// glGenBuffers/glBufferData
+	unsigned int bufferCopies = 0;		// glBufferData/glBufferSubData with data
+	unsigned int glCalls = 0;			// every GL call made while uploading and binding
+	double milliseconds = 0.0;
+};
+
+
+class MeshUploader {
+public:
+	UploadStats stats;
+
+	// copies data into the staging allocation and returns its offset in the final buffer
+	size_t stage(const void* data, size_t size);
+
+	// creates the buffer and copies all staged data into it (the staging allocation is freed)
+	GLuint upload();
+private:
+	std::vector<unsigned char> staging;
+};
+
+#endif
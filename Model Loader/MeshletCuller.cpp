@@ -0,0 +1,137 @@
+#include "MeshletCuller.h"
+
+#include <xmmintrin.h>
+
+
+///////////////////////////////////////////////////
+// Global Vars
+MeshletCuller meshletCuller;
+
+
+void MeshletCuller::begin(const glm::mat4& view, const glm::mat4& projection) {
+	stats = MeshletStats();
+
+	frustum = extractFrustum(projection * view);
+	cameraPosition = glm::vec3(glm::inverse(view)[3]);
+}
+
+bool MeshletCuller::usesMeshlets(const Mesh& mesh, unsigned int lod) const {
+	return enabled && lod == 0 && mesh.inArena() && !mesh.meshlets.empty();
+}
+
+void MeshletCuller::cull(const Mesh& mesh, const glm::mat4& transform, GLuint baseInstance, std::vector<DrawElementsIndirectCommand>& commands) {
+	const MeshletArrays& bounds = getArrays(mesh);
+	const DrawElementsIndirectCommand meshCommand = mesh.getDrawCommand(1, baseInstance, 0);
+
+	///////////////////////////////////////////////////
+	// Planes and camera moved into object space, so the meshlet bounds are used as stored
+	// (a plane transformed by the transpose is normalised again for the sphere test)
+	glm::mat4 transposed = glm::transpose(transform);
+	glm::vec4 planes[6];
+
+	for (int p = 0; p < 6; p++) {
+		planes[p] = transposed * frustum.planes[p];
+		planes[p] /= glm::length(glm::vec3(planes[p]));
+	}
+
+	glm::vec3 camera = glm::vec3(glm::inverse(transform) * glm::vec4(cameraPosition, 1.0f));
+
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	size_t count = mesh.meshlets.size();
+	size_t firstCommand = commands.size();
+
+	for (size_t i = 0; i < count; i += 4) {
+		__m128 cx = _mm_loadu_ps(&bounds.centreX[i]);
+		__m128 cy = _mm_loadu_ps(&bounds.centreY[i]);
+		__m128 cz = _mm_loadu_ps(&bounds.centreZ[i]);
+		__m128 r = _mm_loadu_ps(&bounds.radius[i]);
+		__m128 negativeRadius = _mm_xor_ps(r, signMask);
+
+		__m128 outside = _mm_setzero_ps();
+
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), cx), _mm_mul_ps(_mm_set1_ps(planes[p].y), cy)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].z), cz), _mm_set1_ps(planes[p].w)));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+		}
+
+		// facing away: dot(centre - camera, axis) >= cutoff * |centre - camera| + radius
+		__m128 vx = _mm_sub_ps(cx, _mm_set1_ps(camera.x));
+		__m128 vy = _mm_sub_ps(cy, _mm_set1_ps(camera.y));
+		__m128 vz = _mm_sub_ps(cz, _mm_set1_ps(camera.z));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+		__m128 facing = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&bounds.axisX[i])), _mm_mul_ps(vy, _mm_loadu_ps(&bounds.axisY[i]))), _mm_mul_ps(vz, _mm_loadu_ps(&bounds.axisZ[i])));
+		__m128 backFacing = _mm_cmpge_ps(facing, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&bounds.cutoff[i]), length), r));
+
+		int outsideMask = _mm_movemask_ps(outside);
+		int backFacingMask = _mm_movemask_ps(backFacing);
+
+		///////////////////////////////////////////////////
+		// Visible meshlets extend the previous command when their indices follow on
+		for (size_t lane = 0; lane < 4 && i + lane < count; lane++) {
+			const Meshlet& meshlet = mesh.meshlets[i + lane];
+
+			if (outsideMask & (1 << lane)) {
+				stats.frustumCulled++;
+				stats.culledTriangles += meshlet.triangleCount;
+				continue;
+			}
+
+			if (backFacingMask & (1 << lane)) {
+				stats.coneCulled++;
+				stats.culledTriangles += meshlet.triangleCount;
+				continue;
+			}
+
+			GLuint firstIndex = meshCommand.firstIndex + meshlet.firstIndex;
+
+			if (commands.size() > firstCommand && commands.back().firstIndex + commands.back().count == firstIndex) {
+				commands.back().count += meshlet.triangleCount * 3;
+				continue;
+			}
+
+			DrawElementsIndirectCommand command = meshCommand;
+			command.firstIndex = firstIndex;
+			command.count = meshlet.triangleCount * 3;
+			commands.push_back(command);
+		}
+	}
+
+	stats.tested += count;
+	stats.commands += commands.size() - firstCommand;
+}
+
+
+const MeshletArrays& MeshletCuller::getArrays(const Mesh& mesh) {
+	auto found = arrays.find(&mesh);
+	if (found != arrays.end())
+		return found->second;
+
+	// the last group of four is padded, padded lanes are never read back
+	size_t padded = (mesh.meshlets.size() + 3) & ~(size_t)3;
+
+	MeshletArrays& bounds = arrays[&mesh];
+	bounds.centreX.resize(padded, 0.0f);
+	bounds.centreY.resize(padded, 0.0f);
+	bounds.centreZ.resize(padded, 0.0f);
+	bounds.radius.resize(padded, 0.0f);
+	bounds.axisX.resize(padded, 0.0f);
+	bounds.axisY.resize(padded, 0.0f);
+	bounds.axisZ.resize(padded, 0.0f);
+	bounds.cutoff.resize(padded, 1.0f);
+
+	for (size_t i = 0; i < mesh.meshlets.size(); i++) {
+		const Meshlet& meshlet = mesh.meshlets[i];
+		bounds.centreX[i] = meshlet.centre.x;
+		bounds.centreY[i] = meshlet.centre.y;
+		bounds.centreZ[i] = meshlet.centre.z;
+		bounds.radius[i] = meshlet.radius;
+		bounds.axisX[i] = meshlet.coneAxis.x;
+		bounds.axisY[i] = meshlet.coneAxis.y;
+		bounds.axisZ[i] = meshlet.coneAxis.z;
+		bounds.cutoff[i] = meshlet.coneCutoff;
+	}
+
+	return bounds;
+}
@@ -0,0 +1,65 @@
+#ifndef MESHLETCULLER_H
+#define MESHLETCULLER_H
+
+#include <map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+
+
+///////////////////////////////////////////////////
+// Meshlet Culler
+// Meshes in the geometry arena that were split into meshlets at import are
+// drawn as the meshlets that can be seen instead of as a whole. The meshlets
+// of each visible copy are tested four at a time with SSE, in the copy's
+// object space: their bounding spheres against the view frustum, and their
+// normal cones against the camera position (a meshlet whose triangles all
+// face away is dropped). Surviving meshlets next to each other in the index
+// data are merged, and each range becomes a multi draw command.
+// Cone culling drops back faces, so cones are only built for closed meshes.
+// Non-uniformly scaled copies can be wrongly coned, the transforms here only
+// scale uniformly.
+
+// Meshlet bounds of a mesh as separate arrays (padded to a multiple of 4)
+struct MeshletArrays {
+	std::vector<float> centreX, centreY, centreZ;
+	std::vector<float> radius;
+	std::vector<float> axisX, axisY, axisZ;
+	std::vector<float> cutoff;
+};
+
+// Counters for the last frame
+struct MeshletStats {
+	unsigned int tested = 0;
+	unsigned int frustumCulled = 0;
+	unsigned int coneCulled = 0;
+	unsigned int culledTriangles = 0;
+	unsigned int commands = 0;		// ranges left after merging
+};
+
+
+class MeshletCuller {
+public:
+	MeshletStats stats;
+	bool enabled = true;
+
+	void begin(const glm::mat4& view, const glm::mat4& projection);
+
+	// whether copies of the mesh drawn at that level of detail go through cull()
+	bool usesMeshlets(const Mesh& mesh, unsigned int lod) const;
+
+	// appends a command for each range of visible meshlets of a copy, whose transform is at baseInstance
+	void cull(const Mesh& mesh, const glm::mat4& transform, GLuint baseInstance, std::vector<DrawElementsIndirectCommand>& commands);
+private:
+	std::map<const Mesh*, MeshletArrays> arrays; // built the first time a mesh is culled
+
+	Frustum frustum;
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+
+	const MeshletArrays& getArrays(const Mesh& mesh);
+};
+
+extern MeshletCuller meshletCuller;
+
+#endif
@@ -1,11 +1,113 @@
 #include "Model.h"
+#include "LoadObj.h"
+#include "LoadDae.h"
+#include "ShaderRegistry.h"
+#include "GeometryArena.h"
+#include "GLState.h"
+#include "MaterialTable.h"
+
+#include <algorithm>
+#include <chrono>
 
 
 Model::Model() {
 }
 
-void Model::draw() {
+void Model::setupMeshes() {
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		if (meshes[i].meshType == MeshType::OBJ)
+			meshes[i].textures = processTextures(meshes[i].mtlData, meshes[i].path);
+		else
+			meshes[i].textures = processTextures(meshes[i].path, meshes[i].mtlData.map_Kd);
+
+		meshes[i].materialIndex = materialTable.add(meshes[i].mtlData);
+	}
+
+	// the texture loaders bind textures directly
+	glState.invalidate();
+
+	uploadMeshes();
+}
+
+// re-uploads every mesh with the given vertex format
+void Model::setVertexFormat(VertexPrecision precision, VertexLayout layout) {
+	releaseMeshes();
+
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		meshes[i].precision = precision;
+		meshes[i].layout = layout;
+	}
+
+	uploadMeshes();
+}
+
+// frees the GL objects of every mesh (textures are kept)
+void Model::releaseMeshes() {
+	for (unsigned int i = 0; i < meshes.size(); i++)
+		meshes[i].releaseMesh();
+
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+	buffer = NULL;
+}
+
+// stages every mesh into one allocation, so the model needs a single buffer upload
+// (interleaved meshes are copied into the geometry arena instead when multi draw is supported)
+void Model::uploadMeshes() {
+	auto start = std::chrono::steady_clock::now();
+	double compileStart = shaderRegistry.stats.totalMilliseconds();
+
+	MeshUploader uploader;
+	bool useArena = geometryArena.isSupported();
+
+	for (unsigned int i = 0; i < meshes.size(); i++)
+		meshes[i].stageMesh(uploader, useArena);
+
+	buffer = uploader.upload();
+
+	for (unsigned int i = 0; i < meshes.size(); i++)
+		meshes[i].setupMesh(buffer, uploader.stats);
+
+	// wait for the copy so the time includes the transfer
+	glFinish();
+
+	uploadStats = uploader.stats;
+	uploadStats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// shader variants compiled during setup are reported by the registry
+	uploadStats.milliseconds -= shaderRegistry.stats.totalMilliseconds() - compileStart;
+}
+
+// total memory and worst case error over all meshes
+MeshStats Model::getStats() {
+	MeshStats total;
+
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		MeshStats& stats = meshes[i].stats;
+
+		total.vertexBytes += stats.vertexBytes;
+		total.indexBytes += stats.indexBytes;
+		total.maxPositionError = std::max(total.maxPositionError, stats.maxPositionError);
+		total.maxNormalError = std::max(total.maxNormalError, stats.maxNormalError);
+		total.maxUvError = std::max(total.maxUvError, stats.maxUvError);
+		total.meshlets += stats.meshlets;
+		total.vertexCache.add(stats.vertexCache);
+
+		// meshes with fewer levels are drawn at their coarsest level in the levels past it
+		unsigned int triangles = 0;
+		for (unsigned int lod = 0; lod < MAX_LODS; lod++) {
+			if (stats.lodTriangles[lod] > 0)
+				triangles = stats.lodTriangles[lod];
+			total.lodTriangles[lod] += triangles;
+		}
+	}
+
+	return total;
+}
+
+// each mesh binds its own shader variant, so the transform is set per mesh (the camera is shared)
+void Model::draw(const glm::mat4& modelTrans) {
 	for (unsigned int i = 0; i < meshes.size(); i++) {
-		meshes[i].draw(shader);
+		meshes[i].draw(modelTrans);
 	}
 }
@@ -8,13 +8,22 @@
 
 class Model {
 public:
-	Shader shader;
 	std::string path;
 	std::vector<Mesh> meshes;
 
+	GLuint buffer = NULL; // vertex and index data of every mesh
+	UploadStats uploadStats;
+	VertexCacheStats sourceVertexCache; // level 0 in the order of the source file, kept in the import cache
+
 	Model();
 
-	void draw();
+	void setupMeshes();
+	void setVertexFormat(VertexPrecision precision, VertexLayout layout);
+	void releaseMeshes();
+	MeshStats getStats();
+	void draw(const glm::mat4& modelTrans);
+private:
+	void uploadMeshes();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,398 @@
+#include "ModelCache.h"
+#include "FileUtils.h"
+#include "Hash.h"
+#include "MeshCodec.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+
+///////////////////////////////////////////////////
+// DataTypes
+const uint32_t CACHE_MAGIC = 0x434D454A; // "JEMC"
+const uint32_t CACHE_FORMAT_VERSION = 5;
+
+class BlobReader {
+public:
+	BlobReader(const std::vector<char>& blob, size_t size) : blob(blob), size(size) {}
+
+	template<typename T>
+	bool read(T& value) {
+		if (pos + sizeof(T) > size)
+			return false;
+		memcpy(&value, blob.data() + pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+
+	bool readString(std::string& value) {
+		uint32_t length;
+		if (!read(length) || pos + length > size)
+			return false;
+		value.assign(blob.data() + pos, length);
+		pos += length;
+		return true;
+	}
+
+	template<typename T>
+	bool readVector(std::vector<T>& values) {
+		uint32_t count;
+		if (!read(count) || pos + (size_t)count * sizeof(T) > size)
+			return false;
+		values.resize(count);
+		if (count > 0)
+			memcpy(values.data(), blob.data() + pos, count * sizeof(T));
+		pos += count * sizeof(T);
+		return true;
+	}
+
+private:
+	const std::vector<char>& blob;
+	size_t size;
+	size_t pos = 0;
+};
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+std::string getCachePath(Model& model, uint64_t sourceHash, uint32_t variant);
+std::vector<std::string> getModelDependencies(Model& model);
+template<typename T> void writeValue(std::vector<char>& blob, const T& value);
+void writeString(std::vector<char>& blob, const std::string& value);
+template<typename T> void writeVector(std::vector<char>& blob, const std::vector<T>& values);
+std::vector<uint32_t> getLodCorners(const VecData& vecData, const std::vector<unsigned int>& indices);
+bool readLodCorners(const VecData& vecData, std::vector<unsigned int>& indices);
+template<typename T> bool validRanges(const VecData& vecData, const std::vector<T>& ranges);
+
+
+bool loadCachedModel(Model& model, uint32_t variant, uint64_t& sourceHash) {
+	sourceHash = hashFile(model.path);
+	std::string cachePath = getCachePath(model, sourceHash, variant);
+	std::vector<char> blob;
+
+	if (cachePath.empty() || !readFileBytes(cachePath, blob))
+		return false;
+
+	if (!deserializeModel(blob, model, sourceHash)) {
+		// stale (dependency changed) or damaged blob, it will be overwritten after import
+		model.meshes.clear();
+		model.sourceVertexCache = VertexCacheStats();
+		return false;
+	}
+
+	// mark as recently used for LRU eviction
+	touchFile(cachePath);
+
+	return true;
+}
+
+void saveCachedModel(Model& model, uint32_t variant, uint64_t sourceHash) {
+	std::string cachePath = getCachePath(model, sourceHash, variant);
+
+	if (cachePath.empty() || model.meshes.empty())
+		return;
+
+	if (!writeFileAtomic(cachePath, serializeModel(model, sourceHash))) {
+		std::cout << "WARN->" << __FUNCTION__ << ": Could not write cache file '" << cachePath << "'" << std::endl;
+		return;
+	}
+
+	evictOldestFiles(MODEL_CACHE_DIR, MODEL_CACHE_MAX_BYTES);
+}
+
+
+std::vector<char> serializeModel(Model& model, uint64_t sourceHash) {
+	std::vector<char> blob;
+
+	///////////////////////////////////////////////////
+	// Header
+	writeValue(blob, CACHE_MAGIC);
+	writeValue(blob, CACHE_FORMAT_VERSION);
+	writeValue(blob, IMPORTER_VERSION);
+	writeValue(blob, sourceHash);
+
+	///////////////////////////////////////////////////
+	// Dependencies
+	std::vector<std::string> dependencies = getModelDependencies(model);
+	writeValue(blob, (uint32_t)dependencies.size());
+
+	for (unsigned int i = 0; i < dependencies.size(); i++) {
+		writeString(blob, dependencies[i]);
+		writeValue(blob, hashFile(dependencies[i]));
+	}
+
+	///////////////////////////////////////////////////
+	// Vertex cache rates of the source order (only measured when parsing)
+	writeValue(blob, (uint64_t)model.sourceVertexCache.triangles);
+	writeValue(blob, (uint64_t)model.sourceVertexCache.vertices);
+	writeValue(blob, (uint64_t)model.sourceVertexCache.misses);
+
+	///////////////////////////////////////////////////
+	// Meshes
+	writeValue(blob, (uint32_t)model.meshes.size());
+
+	for (unsigned int i = 0; i < model.meshes.size(); i++) {
+		Mesh& mesh = model.meshes[i];
+
+		writeValue(blob, (uint32_t)mesh.meshType);
+		writeString(blob, mesh.path);
+
+		writeString(blob, mesh.vecData.materialName);
+		writeValue(blob, (uint32_t)mesh.compression);
+
+		if (mesh.compression == MeshCompression::QUANTIZED) {
+			writeVector(blob, encodeVecData(mesh.vecData));
+		}
+		else {
+			writeVector(blob, mesh.vecData.vertices);
+			writeVector(blob, mesh.vecData.uvs);
+			writeVector(blob, mesh.vecData.normals);
+			writeVector(blob, mesh.vecData.indices);
+		}
+
+		writeValue(blob, mesh.bounds);
+
+		writeValue(blob, (uint32_t)mesh.lods.size());
+		for (const MeshLod& lod : mesh.lods) {
+			writeValue(blob, lod.error);
+			writeVector(blob, getLodCorners(mesh.vecData, lod.indices));
+		}
+
+		writeVector(blob, mesh.meshlets);
+		writeVector(blob, mesh.parts);
+
+		writeString(blob, mesh.mtlData.materialName);
+		writeValue(blob, mesh.mtlData.Ns);
+		writeValue(blob, mesh.mtlData.Ka);
+		writeValue(blob, mesh.mtlData.Kd);
+		writeValue(blob, mesh.mtlData.Ks);
+		writeValue(blob, mesh.mtlData.Ke);
+		writeValue(blob, mesh.mtlData.Ni);
+		writeValue(blob, mesh.mtlData.d);
+		writeValue(blob, mesh.mtlData.illum);
+		writeString(blob, mesh.mtlData.map_d);
+		writeString(blob, mesh.mtlData.map_Kd);
+	}
+
+	// trailing checksum to detect truncated or damaged files
+	writeValue(blob, hashBytes(blob.data(), blob.size()));
+
+	return blob;
+}
+
+bool deserializeModel(const std::vector<char>& blob, Model& model, uint64_t sourceHash) {
+	if (blob.size() < sizeof(uint64_t))
+		return false;
+
+	size_t payloadSize = blob.size() - sizeof(uint64_t);
+	uint64_t checksum;
+	memcpy(&checksum, blob.data() + payloadSize, sizeof(checksum));
+
+	if (checksum != hashBytes(blob.data(), payloadSize))
+		return false;
+
+	BlobReader reader(blob, payloadSize);
+
+	///////////////////////////////////////////////////
+	// Header
+	uint32_t magic, formatVersion, importerVersion;
+	uint64_t storedSourceHash;
+
+	if (!reader.read(magic) || magic != CACHE_MAGIC)
+		return false;
+	if (!reader.read(formatVersion) || formatVersion != CACHE_FORMAT_VERSION)
+		return false;
+	if (!reader.read(importerVersion) || importerVersion != IMPORTER_VERSION)
+		return false;
+	if (!reader.read(storedSourceHash) || storedSourceHash != sourceHash)
+		return false;
+
+	///////////////////////////////////////////////////
+	// Dependencies
+	uint32_t numDependencies;
+	if (!reader.read(numDependencies))
+		return false;
+
+	for (unsigned int i = 0; i < numDependencies; i++) {
+		std::string dependency;
+		uint64_t dependencyHash;
+
+		if (!reader.readString(dependency) || !reader.read(dependencyHash))
+			return false;
+
+		if (hashFile(dependency) != dependencyHash)
+			return false;
+	}
+
+	///////////////////////////////////////////////////
+	// Vertex cache rates of the source order
+	uint64_t sourceTriangles, sourceVertices, sourceMisses;
+	if (!reader.read(sourceTriangles) || !reader.read(sourceVertices) || !reader.read(sourceMisses))
+		return false;
+
+	model.sourceVertexCache.triangles = (size_t)sourceTriangles;
+	model.sourceVertexCache.vertices = (size_t)sourceVertices;
+	model.sourceVertexCache.misses = (size_t)sourceMisses;
+
+	///////////////////////////////////////////////////
+	// Meshes
+	uint32_t numMeshes;
+	if (!reader.read(numMeshes))
+		return false;
+
+	for (unsigned int i = 0; i < numMeshes; i++) {
+		Mesh mesh;
+		uint32_t meshType, compression;
+
+		bool valid = reader.read(meshType)
+			&& reader.readString(mesh.path)
+			&& reader.readString(mesh.vecData.materialName)
+			&& reader.read(compression);
+
+		if (valid && compression == (uint32_t)MeshCompression::QUANTIZED) {
+			std::vector<unsigned char> encoded;
+			valid = reader.readVector(encoded) && decodeVecData(encoded.data(), encoded.size(), mesh.vecData);
+		}
+		else {
+			valid = valid && compression == (uint32_t)MeshCompression::NONE
+				&& reader.readVector(mesh.vecData.vertices)
+				&& reader.readVector(mesh.vecData.uvs)
+				&& reader.readVector(mesh.vecData.normals)
+				&& reader.readVector(mesh.vecData.indices);
+		}
+
+		uint32_t numLods = 0;
+		valid = valid
+			&& reader.read(mesh.bounds)
+			&& reader.read(numLods) && numLods < MAX_LODS;
+
+		for (unsigned int j = 0; valid && j < numLods; j++) {
+			MeshLod lod;
+			valid = reader.read(lod.error)
+				&& reader.readVector(lod.indices)
+				&& readLodCorners(mesh.vecData, lod.indices);
+			mesh.lods.push_back(lod);
+		}
+
+		valid = valid
+			&& reader.readVector(mesh.meshlets)
+			&& validRanges(mesh.vecData, mesh.meshlets)
+			&& reader.readVector(mesh.parts)
+			&& validRanges(mesh.vecData, mesh.parts)
+			&& reader.readString(mesh.mtlData.materialName)
+			&& reader.read(mesh.mtlData.Ns)
+			&& reader.read(mesh.mtlData.Ka)
+			&& reader.read(mesh.mtlData.Kd)
+			&& reader.read(mesh.mtlData.Ks)
+			&& reader.read(mesh.mtlData.Ke)
+			&& reader.read(mesh.mtlData.Ni)
+			&& reader.read(mesh.mtlData.d)
+			&& reader.read(mesh.mtlData.illum)
+			&& reader.readString(mesh.mtlData.map_d)
+			&& reader.readString(mesh.mtlData.map_Kd);
+
+		if (!valid)
+			return false;
+
+		mesh.meshType = (MeshType)meshType;
+		mesh.compression = (MeshCompression)compression;
+		model.meshes.push_back(mesh);
+	}
+
+	return true;
+}
+
+
+std::string getCachePath(Model& model, uint64_t sourceHash, uint32_t variant) {
+	if (sourceHash == 0)
+		return "";
+
+	// the path is part of the key as relative texture/mtl lookups depend on it
+	uint64_t key = hashCombine(hashCombine(hashString(model.path, sourceHash), IMPORTER_VERSION), variant);
+
+	return MODEL_CACHE_DIR + "/" + hashToHex(key) + ".bin";
+}
+
+std::vector<std::string> getModelDependencies(Model& model) {
+	std::vector<std::string> dependencies;
+
+	// obj models look for an mtl file with the same name
+	for (unsigned int i = 0; i < model.meshes.size(); i++) {
+		if (model.meshes[i].meshType == MeshType::OBJ) {
+			dependencies.push_back(model.path.substr(0, model.path.find_last_of(".")) + ".mtl");
+			break;
+		}
+	}
+
+	for (unsigned int i = 0; i < model.meshes.size(); i++) {
+		MtlData& mtlData = model.meshes[i].mtlData;
+
+		if (!mtlData.map_d.empty())
+			dependencies.push_back(model.meshes[i].path + "\\" + mtlData.map_d);
+		if (!mtlData.map_Kd.empty())
+			dependencies.push_back(model.meshes[i].path + "\\" + mtlData.map_Kd);
+	}
+
+	std::sort(dependencies.begin(), dependencies.end());
+	dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+
+	return dependencies;
+}
+
+
+template<typename T>
+void writeValue(std::vector<char>& blob, const T& value) {
+	const char* bytes = (const char*)&value;
+	blob.insert(blob.end(), bytes, bytes + sizeof(T));
+}
+
+void writeString(std::vector<char>& blob, const std::string& value) {
+	writeValue(blob, (uint32_t)value.size());
+	blob.insert(blob.end(), value.begin(), value.end());
+}
+
+template<typename T>
+void writeVector(std::vector<char>& blob, const std::vector<T>& values) {
+	writeValue(blob, (uint32_t)values.size());
+	if (!values.empty()) {
+		const char* bytes = (const char*)values.data();
+		blob.insert(blob.end(), bytes, bytes + values.size() * sizeof(T));
+	}
+}
+
+// LOD indices are stored as the first level 0 corner using each vertex,
+// which stays valid when the quantized codec renumbers the vertices
+std::vector<uint32_t> getLodCorners(const VecData& vecData, const std::vector<unsigned int>& indices) {
+	std::vector<uint32_t> firstCorner(vecData.vertices.size(), 0);
+	for (unsigned int i = (unsigned int)vecData.indices.size(); i-- > 0; )
+		firstCorner[vecData.indices[i]] = i;
+
+	std::vector<uint32_t> corners(indices.size());
+	for (unsigned int i = 0; i < indices.size(); i++)
+		corners[i] = firstCorner[indices[i]];
+
+	return corners;
+}
+
+bool readLodCorners(const VecData& vecData, std::vector<unsigned int>& indices) {
+	for (unsigned int i = 0; i < indices.size(); i++) {
+		if (indices[i] >= vecData.indices.size())
+			return false;
+
+		indices[i] = vecData.indices[indices[i]];
+	}
+
+	return true;
+}
+
+// meshlets and parts are ranges of the level 0 indices, which the quantized codec keeps in order
+template<typename T>
+bool validRanges(const VecData& vecData, const std::vector<T>& ranges) {
+	for (const T& range : ranges) {
+		if ((size_t)range.firstIndex + (size_t)range.triangleCount * 3 > vecData.indices.size())
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,36 @@
+#ifndef MODELCACHE_H
+#define MODELCACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Model.h"
+
+
+///////////////////////////////////////////////////
+// Import Cache
+// Models are stored as binary blobs named after a hash of the source file and
+// the importer version. Each blob also records the hash of every dependency
+// (mtl and texture files), which are re-checked before the blob is used.
+
+// bump whenever the loaders change the data they produce
+const uint32_t IMPORTER_VERSION = 11;
+
+const std::string MODEL_CACHE_DIR = "cache/models";
+const uintmax_t MODEL_CACHE_MAX_BYTES = 512ull * 1024 * 1024;
+
+
+// fills the model meshes from the cache, returns false on a cache miss
+// (variant: the import options the model was processed with, see ImportOptions)
+// sourceHash is set to the hash of the model file, to be passed on to saveCachedModel after a miss
+bool loadCachedModel(Model& model, uint32_t variant, uint64_t& sourceHash);
+
+// writes the imported model to the cache and evicts old entries
+void saveCachedModel(Model& model, uint32_t variant, uint64_t sourceHash);
+
+// model (de)serialisation, deserializeModel also validates the dependency hashes
+std::vector<char> serializeModel(Model& model, uint64_t sourceHash);
+bool deserializeModel(const std::vector<char>& blob, Model& model, uint64_t sourceHash);
+
+#endif
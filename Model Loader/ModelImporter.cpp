@@ -0,0 +1,89 @@
+#include "ModelImporter.h"
+#include "ModelCache.h"
+#include "LoadObj.h"
+#include "LoadDae.h"
+#include "MeshProcessing.h"
+#include "MeshSimplifier.h"
+#include "IndexOptimizer.h"
+
+#include <regex>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+
+ModelFormat getModelFormat(const std::string& path) {
+	std::regex pattern(".[a-z0-9]+$", std::regex_constants::icase);
+	std::smatch fileExtension;
+	std::regex_search(path, fileExtension, pattern);
+
+	if (fileExtension.empty())
+		return ModelFormat::UNSUPPORTED;
+
+	if (fileExtension[0] == ".obj")
+		return ModelFormat::OBJ;
+	else if (fileExtension[0] == ".dae")
+		return ModelFormat::DAE;
+
+	return ModelFormat::UNSUPPORTED;
+}
+
+bool importModel(Model& model, const ImportOptions& options) {
+	ModelFormat format = getModelFormat(model.path);
+
+	if (format == ModelFormat::UNSUPPORTED)
+		return false;
+
+	// only parse the file if there is no up to date copy in the import cache
+	// (the file is hashed once, the hash of a miss keys the blob written after the import)
+	uint64_t sourceHash = 0;
+	if (options.useCache && loadCachedModel(model, options.getCacheVariant(), sourceHash))
+		return true;
+
+	// a corrupt file fails its own import, the parsers' number conversions throw on malformed values
+	bool parsed = false;
+	try {
+		parsed = format == ModelFormat::OBJ ? loadObj(model) : loadDae(model);
+	}
+	catch (const std::exception& e) {
+		std::cout << "ERROR->" << __FUNCTION__ << ": Unable to parse '" << model.path << "', the file may be corrupt (" << e.what() << ")" << std::endl;
+	}
+
+	if (!parsed) {
+		model.meshes.clear();
+		return false;
+	}
+
+	// faces the parsers skip (an obj n-gon) can close a mesh that has no vertices of its own
+	model.meshes.erase(std::remove_if(model.meshes.begin(), model.meshes.end(),
+		[](const Mesh& mesh) { return mesh.vecData.vertices.empty(); }), model.meshes.end());
+
+	for (unsigned int i = 0; i < model.meshes.size(); i++) {
+		Mesh& mesh = model.meshes[i];
+
+		indexVecData(mesh.vecData, mesh.bounds);
+		model.sourceVertexCache.add(measureVertexCache(mesh.vecData.indices));
+
+		buildMeshlets(mesh.vecData, mesh.meshlets);
+
+		// the levels of detail index the renumbered vertices, so they come after
+		if (options.optimizeIndexOrder)
+			optimizeIndexOrder(mesh.vecData, mesh.meshlets);
+
+		generateLods(mesh.vecData, mesh.lods);
+
+		if (options.optimizeIndexOrder) {
+			for (unsigned int j = 0; j < mesh.lods.size(); j++)
+				optimizeVertexCache(mesh.lods[j].indices);
+		}
+	}
+
+	// each mesh is finished on its own first, so the parts keep their own order, meshlets and levels
+	if (options.batchByMaterial)
+		batchMeshes(model.meshes);
+
+	if (options.useCache)
+		saveCachedModel(model, options.getCacheVariant(), sourceHash);
+
+	return true;
+}
@@ -0,0 +1,34 @@
+#ifndef MODELIMPORTER_H
+#define MODELIMPORTER_H
+
+#include <string>
+#include <cstdint>
+
+#include "Model.h"
+
+
+///////////////////////////////////////////////////
+// DataTypes
+enum class ModelFormat {
+	OBJ,
+	DAE,
+	UNSUPPORTED
+};
+
+struct ImportOptions {
+	bool useCache = true;
+	bool optimizeIndexOrder = true;	// reorder triangles and vertices for the vertex cache, overdraw and vertex fetch
+	bool batchByMaterial = true;	// merge the meshes sharing a material and textures (MeshProcessing.h)
+
+	// the options that change the imported data, part of the cache key
+	uint32_t getCacheVariant() const { return (optimizeIndexOrder ? 1 : 0) | (batchByMaterial ? 2 : 0); }
+};
+
+
+ModelFormat getModelFormat(const std::string& path);
+
+// parses model.path (or loads it from the import cache) into model.meshes
+// no OpenGL calls are made, so this is safe to use without a context
+bool importModel(Model& model, const ImportOptions& options = ImportOptions());
+
+#endif
@@ -1,8 +1,22 @@
 #include "ModelLoader.h"
-#include "LoadObj.h"
-#include "LoadDae.h"
+#include "ModelImporter.h"
 #include "Shader.h"
+#include "ShaderRegistry.h"
+#include "ShaderCache.h"
 #include "Model.h"
+#include "AssetRegistry.h"
+#include "GeometryArena.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
+#include "OcclusionQueries.h"
+#include "LodSelector.h"
+#include "MeshletCuller.h"
+#include "GLState.h"
+#include "FrameUniforms.h"
+#include "MaterialTable.h"
+#include "Benchmark.h"
 
 
 /*******************************************************
@@ -31,13 +45,23 @@ struct displayObj {
 // Forward Declarations
 bool getModelPaths(std::vector<std::string>& modelPaths);
 void clearInput();
-bool loadModels(std::vector<std::string>& modelPaths, std::vector<Model>& models);
-void display(GLFWwindow* window, std::vector<Model> models);
-void processInput(GLFWwindow* window, std::vector<Model>& models, float& scaleFactor);
+bool loadModels(std::vector<std::string>& modelPaths, std::vector<Model*>& models);
+void display(GLFWwindow* window, std::vector<Model*> models);
+void processInput(GLFWwindow* window, std::vector<Model*>& models, float& scaleFactor);
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void mouseCallback(GLFWwindow* window, double xPos, double yPos);
 void scrollCallback(GLFWwindow* window, double xOffset, double yOffset);
-void setUniformMatrix(Shader shaders, glm::mat4 matrix, const char* uniformName);
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+glm::mat4 getModelTransform(int index);
+glm::mat4 getViewMatrix();
+glm::mat4 getProjectionMatrix();
+bool sameTransform(const glm::mat4& a, const glm::mat4& b);
+void updateScene(std::vector<Model*>& models);
+void pickMesh(GLFWwindow* window);
+void printMemoryUsage();
+void updateWindowTitle(GLFWwindow* window);
+void printFrameReport(const ShaderStats& frameShaderStats, const GLStateStats& frameStateStats);
+std::string getVertexFormatName();
 void onWindowResize(GLFWwindow* window, int width, int height);
 void printWelcomeAscii();
 
@@ -58,6 +82,8 @@ double lastY = 300;
 double yaw = -90.0f;
 double pitch = 0.0f;
 double fov = 45.0f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 250.0f;
 bool firstMouse = true;
 WindowStatus windowStatus = WindowStatus::FOCUSED;
 
@@ -65,18 +91,45 @@ WindowStatus windowStatus = WindowStatus::FOCUSED;
 bool captureMouse = true;
 bool wireframe = false;
 float scaleFactor = 1.0f;
+VertexPrecision vertexPrecision = VertexPrecision::FULL;
+VertexLayout vertexLayout = VertexLayout::INTERLEAVED;
+RenderQueue renderQueue;
+FrustumCuller frustumCuller;
+SceneBVH sceneBVH;
+OcclusionCuller occlusionCuller;
+LodSelector lodSelector;
+std::vector<glm::mat4> sceneTransforms; // model transforms the scene BVH was last fitted to
 
 // timing
 float deltaTime = 0.0f; // Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last frame
 bool awaitingRelease = false;
+float frameTimeTotal = 0.0f; // frame times since the title was last updated
+int frameCount = 0;
+float lastTitleUpdate = 0.0f;
 
 // user feedback
 bool displayAscii = true;
+bool printFrameStats = false; // per-subsystem stats printed with every title update, toggled with 0
 
 
-int main()
+int main(int argc, char** argv)
 {
+	// --benchmark [frames] measures the vertex formats instead of loading models
+	if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+		glfwInit();
+
+		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, DEFAULT_SCR_TITLE, NULL, NULL);
+		glfwMakeContextCurrent(window);
+		glewInit();
+		initParallelCompile();
+
+		runBenchmark(window, argc > 2 ? std::max(1, atoi(argv[2])) : 100);
+
+		glfwTerminate();
+		return EXIT_SUCCESS;
+	}
+
 	std::vector<std::string> modelPaths;
 
 	// Ask user for model paths (keep asking until they enter valid strings)
@@ -95,14 +148,17 @@ int main()
 	glfwSetFramebufferSizeCallback(window, onWindowResize);
 
 	glewInit();
+	initParallelCompile();
 
-	// Load the models (includes setting up meshes)
-	std::vector<Model> models;
+	// Load the models (includes setting up meshes), repeated paths share one model
+	std::vector<Model*> models;
 	if (!loadModels(modelPaths, models)) {
 		std::cout << "ERROR->" << __FUNCTION__ << ": Could not load models";
 		exit(EXIT_FAILURE);
 	}
 
+	printMemoryUsage();
+
 	display(window, models);
 }
 
@@ -167,30 +223,14 @@ void clearInput() {
 	std::cin.ignore(512, '\n');
 }
 
-bool loadModels(std::vector<std::string>& modelPaths, std::vector<Model>& models) {
+bool loadModels(std::vector<std::string>& modelPaths, std::vector<Model*>& models) {
 	///////////////////////////////////////////////////
 	// Read Model
 
 	for (int i = 0; i < modelPaths.size(); i++) {
-		std::regex pattern(".[a-z0-9]+$", std::regex_constants::icase);
-		std::smatch fileExtension;
-		std::regex_search(modelPaths[i], fileExtension, pattern);
-
-		Model model;
-
-		// Build ,compile and equip shaders
-		Shader shaders("shaders/shader.vs", "shaders/shader.fs");
-		model.shader = shaders;
+		Model* model = assetRegistry.getModel(modelPaths[i]);
 
-		if (fileExtension[0] == ".obj") {
-			model.path = modelPaths[i];
-			loadObj(model);
-		}
-		else if (fileExtension[0] == ".dae") {
-			model.path = modelPaths[i];
-			loadDae(model);
-		}
-		else {
+		if (model == NULL) {
 			system("cls");
 
 			printWelcomeAscii();
@@ -207,23 +247,43 @@ bool loadModels(std::vector<std::string>& modelPaths, std::vector<Model>& models
 		}
 
 		models.push_back(model);
+
+		// programs submitted so far keep compiling while the next model is parsed
+		shaderRegistry.update();
 	}
+
+	std::cout << "Models: " << assetRegistry.stats.imported << " imported for " << models.size() << " instances" << std::endl;
+
+	ShaderRegistryStats& registryStats = shaderRegistry.stats;
+	std::cout << "Shader programs: " << registryStats.programsLoaded + registryStats.programsCompiled << " built for " << models.size() << " models ("
+		<< registryStats.programsShared << " shared, " << shaderRegistry.pendingCount() << " still compiling)" << std::endl;
+	std::cout << "    " << registryStats.programsLoaded << " loaded from the program cache in " << registryStats.loadMilliseconds << "ms, "
+		<< registryStats.programsCompiled << " compiled from source in " << registryStats.compileMilliseconds << "ms" << std::endl;
 	
 	return true;
 }
 
-void display(GLFWwindow* window, std::vector<Model> models) {
+void display(GLFWwindow* window, std::vector<Model*> models) {
 	// Attach input callbacks
 	glfwSetKeyCallback(window, keyCallback); // only used to check key releases
 	glfwSetCursorPosCallback(window, mouseCallback);
 	glfwSetScrollCallback(window, scrollCallback);
+	glfwSetMouseButtonCallback(window, mouseButtonCallback);
 
 	// Record mouse input
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	
-	glEnable(GL_DEPTH_TEST);
+	glState.setEnabled(GL_DEPTH_TEST, true);
 	
 	while (!glfwWindowShouldClose(window)) {
+		// meshes are skipped until their shader variant has compiled
+		if (shaderRegistry.pendingCount() > 0) {
+			shaderRegistry.update();
+
+			if (shaderRegistry.pendingCount() == 0)
+				std::cout << "Shader programs ready after " << glfwGetTime() << "s (" << shaderRegistry.stats.compileMilliseconds << "ms blocked)" << std::endl;
+		}
+
 		// Frame timer logic
 		float currFrame = (float)glfwGetTime();
 		deltaTime = currFrame - lastFrame;
@@ -232,47 +292,62 @@ void display(GLFWwindow* window, std::vector<Model> models) {
 		glClearColor(0.25f, 0.25f, 0.25f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		float posOffset = 0.0f;
-
-		for (int i = 0; i < models.size(); i++) {
-			// Model transformations
-			glm::mat4 modelTrans = glm::mat4(1.0f);
-			glm::mat4 view = glm::mat4(1.0f);
-			glm::mat4 projection = glm::mat4(1.0f);
-
-			float angleDelta = (float)glfwGetTime() * 0.4f;
-
-			//modelTrans = glm::rotate(modelTrans, angleDelta, glm::vec3(1.0f, 1.0f, 0.0f));
-			//modelTrans = glm::scale(modelTrans, glm::vec3(0.008f, 0.008f, 0.008f));
-			modelTrans = glm::scale(modelTrans, glm::vec3(scaleFactor, scaleFactor, scaleFactor));
-			modelTrans = glm::translate(modelTrans, glm::vec3(posOffset, 0.0f, 0.0f));
-			posOffset += 5;
-
-			view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-
-			projection = glm::perspective(glm::radians((float)fov), (float)(SCR_WIDTH/SCR_HEIGHT), 0.1f, 250.0f);
+		glm::mat4 view = getViewMatrix();
+		glm::mat4 projection = getProjectionMatrix();
+
+		// Model transformations (the scene BVH is rebuilt when models are removed and refitted when they move)
+		updateScene(models);
+
+		// Cull the scene hierarchically, meshes in nodes crossing the frustum are left to the SIMD test
+		frustumCuller.begin(view, projection);
+		sceneBVH.cullFrustum(frustumCuller);
+
+		// Camera block shared by every program this frame, and the materials of models loaded since the last one
+		frameUniforms.begin(view, projection);
+		materialTable.bind();
+
+		// Queue the visible meshes (drawn sorted by state once every mesh is queued, copies are instanced)
+		renderQueue.begin(view, projection, FAR_PLANE);
+		occlusionQueries.begin(view, projection);
+		lodSelector.begin(view, projection, SCR_HEIGHT);
+		meshletCuller.begin(view, projection);
+
+		// meshes hidden behind the largest visible ones are dropped by the CPU depth test,
+		// meshes the GPU found hidden last time are drawn conditionally on a new query of their box,
+		// the rest are drawn at the coarsest level of detail whose error stays under a pixel
+		// (full detail copies of split meshes only draw their visible meshlets)
+		for (const CullItem& item : occlusionCuller.cull(frustumCuller.cull(), projection * view)) {
+			unsigned int lod = lodSelector.select(item);
+			renderQueue.submit(*item.mesh, item.transform, occlusionQueries.getQuery(item, lod), lod);
+		}
 
-			// Select shaders
-			setUniformMatrix(models[i].shader, modelTrans, "model");
-			setUniformMatrix(models[i].shader, view, "view");
-			setUniformMatrix(models[i].shader, projection, "projection");
-		
-			// Draw the models
-			models[i].draw();
-		}		
+		renderQueue.flush();
+		occlusionQueries.end();
+		lodSelector.end();
+		frameUniforms.end();
 		
 		// Check inputs
 		processInput(window, models, scaleFactor);
 
+		updateWindowTitle(window);
+
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
 
+	renderQueue.release();
+	frameUniforms.release();
+	materialTable.release();
+	occlusionCuller.release();
+	occlusionQueries.release();
+	assetRegistry.clear();
+	geometryArena.clear();
+	shaderRegistry.clear();
 	glfwTerminate();
 }
 
 
-void processInput(GLFWwindow* window, std::vector<Model>& models, float& scaleFactor) {
+void processInput(GLFWwindow* window, std::vector<Model*>& models, float& scaleFactor) {
 	if ((glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) && !awaitingRelease) {
 		firstMouse = true;
 		captureMouse = !captureMouse;
@@ -308,17 +383,54 @@ void processInput(GLFWwindow* window, std::vector<Model>& models, float& scaleFa
 			scaleFactor -= scaleDelta;
 	if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS && !awaitingRelease) {
 		wireframe = !wireframe;
-		wireframe ? glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) : glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glState.polygonMode(wireframe ? GL_LINE : GL_FILL);
 		awaitingRelease = true;
 	}
 	if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS && !awaitingRelease) {
-		GLint hasTexture;
+		Mesh::texturesEnabled = !Mesh::texturesEnabled;
+		awaitingRelease = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS && !awaitingRelease) {
+		vertexPrecision = vertexPrecision == VertexPrecision::FULL ? VertexPrecision::QUANTIZED : VertexPrecision::FULL;
 
-		for (unsigned int i = 0; i < models.size(); i++) {
-			models[i].shader.use();
-			glGetUniformiv(models[i].shader.ID, glGetUniformLocation(models[i].shader.ID, "hasTexture"), &hasTexture);
-			hasTexture ? glUniform1i(glGetUniformLocation(models[i].shader.ID, "hasTexture"), false) : glUniform1i(glGetUniformLocation(models[i].shader.ID, "hasTexture"), true);
-		}
+		for (Model* model : assetRegistry.getModels())
+			model->setVertexFormat(vertexPrecision, vertexLayout);
+
+		printMemoryUsage();
+		awaitingRelease = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_5) == GLFW_PRESS && !awaitingRelease) {
+		vertexLayout = vertexLayout == VertexLayout::INTERLEAVED ? VertexLayout::PLANAR : VertexLayout::INTERLEAVED;
+
+		for (Model* model : assetRegistry.getModels())
+			model->setVertexFormat(vertexPrecision, vertexLayout);
+
+		printMemoryUsage();
+		awaitingRelease = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_6) == GLFW_PRESS && !awaitingRelease) {
+		occlusionCuller.enabled = !occlusionCuller.enabled;
+		std::cout << "Occlusion culling " << (occlusionCuller.enabled ? "enabled" : "disabled") << std::endl;
+		awaitingRelease = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_7) == GLFW_PRESS && !awaitingRelease) {
+		occlusionQueries.enabled = !occlusionQueries.enabled;
+		std::cout << "Occlusion queries " << (occlusionQueries.enabled ? "enabled" : "disabled") << std::endl;
+		awaitingRelease = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_8) == GLFW_PRESS && !awaitingRelease) {
+		lodSelector.enabled = !lodSelector.enabled;
+		std::cout << "Level of detail selection " << (lodSelector.enabled ? "enabled" : "disabled") << std::endl;
+		awaitingRelease = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_9) == GLFW_PRESS && !awaitingRelease) {
+		meshletCuller.enabled = !meshletCuller.enabled;
+		std::cout << "Meshlet culling " << (meshletCuller.enabled ? "enabled" : "disabled") << std::endl;
+		awaitingRelease = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_0) == GLFW_PRESS && !awaitingRelease) {
+		printFrameStats = !printFrameStats;
+		std::cout << "Frame stats report " << (printFrameStats ? "enabled" : "disabled") << std::endl;
 		awaitingRelease = true;
 	}
 	if (glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_PRESS && !awaitingRelease) {
@@ -329,6 +441,114 @@ void processInput(GLFWwindow* window, std::vector<Model>& models, float& scaleFa
 }
 
 
+// models are laid out along the x axis, 5 units apart
+glm::mat4 getModelTransform(int index) {
+	glm::mat4 modelTrans = glm::mat4(1.0f);
+
+	//modelTrans = glm::scale(modelTrans, glm::vec3(0.008f, 0.008f, 0.008f));
+	modelTrans = glm::scale(modelTrans, glm::vec3(scaleFactor, scaleFactor, scaleFactor));
+	modelTrans = glm::translate(modelTrans, glm::vec3(index * 5.0f, 0.0f, 0.0f));
+
+	return modelTrans;
+}
+
+glm::mat4 getViewMatrix() {
+	return glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+}
+
+glm::mat4 getProjectionMatrix() {
+	return glm::perspective(glm::radians((float)fov), (float)(SCR_WIDTH/SCR_HEIGHT), NEAR_PLANE, FAR_PLANE);
+}
+
+bool sameTransform(const glm::mat4& a, const glm::mat4& b) {
+	for (int column = 0; column < 4; column++) {
+		if (a[column] != b[column])
+			return false;
+	}
+
+	return true;
+}
+
+// keeps the scene BVH in step with the models, only the moved models are updated before a refit
+void updateScene(std::vector<Model*>& models) {
+	size_t numMeshes = 0;
+	for (unsigned int i = 0; i < models.size(); i++)
+		numMeshes += models[i]->meshes.size();
+
+	if (sceneTransforms.size() != models.size() || sceneBVH.size() != numMeshes) {
+		std::vector<SceneObject> objects;
+		sceneTransforms.clear();
+
+		for (unsigned int i = 0; i < models.size(); i++) {
+			sceneTransforms.push_back(getModelTransform(i));
+
+			for (unsigned int j = 0; j < models[i]->meshes.size(); j++) {
+				SceneObject object;
+				object.mesh = &models[i]->meshes[j];
+				object.transform = sceneTransforms[i];
+				object.model = i;
+				objects.push_back(object);
+			}
+		}
+
+		sceneBVH.build(objects);
+		return;
+	}
+
+	bool moved = false;
+	unsigned int firstObject = 0;
+
+	for (unsigned int i = 0; i < models.size(); i++) {
+		glm::mat4 transform = getModelTransform(i);
+
+		if (!sameTransform(transform, sceneTransforms[i])) {
+			for (unsigned int j = 0; j < models[i]->meshes.size(); j++)
+				sceneBVH.setTransform(firstObject + j, transform);
+
+			sceneTransforms[i] = transform;
+			moved = true;
+		}
+
+		firstObject += models[i]->meshes.size();
+	}
+
+	if (moved)
+		sceneBVH.refit();
+}
+
+// casts a ray through the cursor (the screen centre while the mouse is captured) and reports the nearest mesh
+void pickMesh(GLFWwindow* window) {
+	int width, height;
+	glfwGetWindowSize(window, &width, &height);
+
+	double x = width / 2.0;
+	double y = height / 2.0;
+	if (!captureMouse)
+		glfwGetCursorPos(window, &x, &y);
+
+	// the ray leaves the camera through the point under the cursor
+	glm::vec2 ndc = glm::vec2((float)(2.0 * x / width - 1.0), (float)(1.0 - 2.0 * y / height));
+	glm::mat4 inverseViewProjection = glm::inverse(getProjectionMatrix() * getViewMatrix());
+
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+	glm::vec3 origin = cameraPos;
+	glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - glm::vec3(nearPoint) / nearPoint.w);
+
+	RayHit hit;
+	if (!sceneBVH.raycast(origin, direction, hit)) {
+		std::cout << "Picked nothing (" << sceneBVH.stats.trianglesTested << " triangles tested)" << std::endl;
+		return;
+	}
+
+	const SceneObject& object = sceneBVH.getObjects()[hit.object];
+	std::cout << "Picked model " << object.model + 1 << " (" << object.mesh->path << "), material '" << object.mesh->mtlData.materialName << "', ";
+	if (!object.mesh->parts.empty())
+		std::cout << "part " << hit.part + 1 << " of " << object.mesh->parts.size() << ", ";
+	std::cout << "triangle " << hit.triangle / 3 << " at " << hit.distance << " units (" << sceneBVH.stats.trianglesTested << " triangles tested)" << std::endl;
+}
+
+
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
 	if (GLFW_KEY_1 && action == GLFW_RELEASE)
 		awaitingRelease = false;
@@ -336,6 +556,20 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		awaitingRelease = false;
 	if (GLFW_KEY_3 && action == GLFW_RELEASE)
 		awaitingRelease = false;
+	if (GLFW_KEY_4 && action == GLFW_RELEASE)
+		awaitingRelease = false;
+	if (GLFW_KEY_5 && action == GLFW_RELEASE)
+		awaitingRelease = false;
+	if (GLFW_KEY_6 && action == GLFW_RELEASE)
+		awaitingRelease = false;
+	if (GLFW_KEY_7 && action == GLFW_RELEASE)
+		awaitingRelease = false;
+	if (GLFW_KEY_8 && action == GLFW_RELEASE)
+		awaitingRelease = false;
+	if (GLFW_KEY_9 && action == GLFW_RELEASE)
+		awaitingRelease = false;
+	if (GLFW_KEY_0 && action == GLFW_RELEASE)
+		awaitingRelease = false;
 	if (GLFW_KEY_BACKSPACE && action == GLFW_RELEASE)
 		awaitingRelease = false;
 }
@@ -380,6 +614,12 @@ void mouseCallback(GLFWwindow* window, double xPos, double yPos) {
 }
 
 
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+		pickMesh(window);
+}
+
+
 void scrollCallback(GLFWwindow* window, double xOffset, double yOffset) {
 	// Limit fov between 1.0f and 45.0f
 	if (fov >= 1.0f && fov <= 45.0f)
@@ -391,9 +631,133 @@ void scrollCallback(GLFWwindow* window, double xOffset, double yOffset) {
 }
 
 
-void setUniformMatrix(Shader shaders, glm::mat4 matrix, const char* uniformName) {
-	unsigned int loc = glGetUniformLocation(shaders.ID, uniformName);
-	glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(matrix));
+// memory of each unique model, copies share their buffers
+void printMemoryUsage() {
+	const std::vector<Model*>& models = assetRegistry.getModels();
+	std::cout << "Vertex format: " << getVertexFormatName() << std::endl;
+
+	size_t totalBytes = 0;
+
+	for (unsigned int i = 0; i < models.size(); i++) {
+		MeshStats stats = models[i]->getStats();
+		totalBytes += stats.vertexBytes + stats.indexBytes;
+
+		UploadStats& upload = models[i]->uploadStats;
+
+		std::cout << "  " << models[i]->path << ": "
+			<< stats.vertexBytes / 1024.0f << "KB vertices, " << stats.indexBytes / 1024.0f << "KB indices";
+
+		if (vertexPrecision == VertexPrecision::QUANTIZED) {
+			std::cout << " (max error: position " << stats.maxPositionError
+				<< ", normal " << stats.maxNormalError << " deg, uv " << stats.maxUvError << ")";
+		}
+		std::cout << std::endl;
+
+		std::cout << "    triangles per level of detail:";
+		for (unsigned int lod = 0; lod < MAX_LODS; lod++)
+			std::cout << (lod > 0 ? " / " : " ") << stats.lodTriangles[lod];
+		std::cout << ", " << stats.meshlets << " meshlets" << std::endl;
+
+		std::cout << "    vertex cache: ACMR " << stats.vertexCache.acmr() << ", ATVR " << stats.vertexCache.atvr();
+		if (models[i]->sourceVertexCache.triangles > 0)
+			std::cout << " (source order: ACMR " << models[i]->sourceVertexCache.acmr() << ", ATVR " << models[i]->sourceVertexCache.atvr() << ")";
+		std::cout << std::endl;
+
+		// meshes batched at import count as their parts
+		size_t sourceMeshes = 0;
+		for (const Mesh& mesh : models[i]->meshes)
+			sourceMeshes += std::max<size_t>(mesh.parts.size(), 1);
+
+		std::cout << "    uploaded " << models[i]->meshes.size() << " meshes";
+		if (sourceMeshes > models[i]->meshes.size())
+			std::cout << " (batched from " << sourceMeshes << ")";
+		std::cout << " in " << upload.milliseconds << "ms ("
+			<< upload.bufferAllocations << " buffer allocations, " << upload.bufferCopies << " copies, "
+			<< upload.glCalls << " GL calls)" << std::endl;
+	}
+
+	ArenaStats arenaStats = geometryArena.getStats();
+	if (arenaStats.pools > 0) {
+		std::cout << "  Geometry arena: " << arenaStats.meshes << " meshes in " << arenaStats.pools << " pools ("
+			<< (arenaStats.vertexBytes + arenaStats.indexBytes) / (1024.0f * 1024.0f) << "MB allocated)" << std::endl;
+	}
+
+	std::cout << "  Material table: " << materialTable.size() << " of " << MAX_MATERIALS << " materials" << std::endl;
+
+	std::cout << "  Total: " << totalBytes / (1024.0f * 1024.0f) << "MB" << std::endl << std::endl;
+}
+
+
+void updateWindowTitle(GLFWwindow* window) {
+	frameTimeTotal += deltaTime;
+	frameCount++;
+
+	// uniform counters cover a single frame
+	ShaderStats frameShaderStats = shaderStats;
+	shaderStats = ShaderStats();
+	RenderStats& renderStats = renderQueue.stats;
+	GLStateStats frameStateStats = glState.stats;
+	glState.stats = GLStateStats();
+
+	// averaged over half a second so the value is readable
+	if (lastFrame - lastTitleUpdate < 0.5f)
+		return;
+
+	float frameMilliseconds = frameTimeTotal / frameCount * 1000.0f;
+
+	// the title only carries what is readable at a glance, the rest is in the report
+	std::ostringstream title;
+	title.precision(3);
+	title << DEFAULT_SCR_TITLE << " | " << 1000.0f / frameMilliseconds << " fps (" << frameMilliseconds << "ms)"
+		<< " | " << renderStats.draws << " draws, " << renderStats.instances << " instances";
+
+	glfwSetWindowTitle(window, title.str().c_str());
+
+	if (printFrameStats)
+		printFrameReport(frameShaderStats, frameStateStats);
+
+	frameTimeTotal = 0.0f;
+	frameCount = 0;
+	lastTitleUpdate = lastFrame;
+}
+
+// stats of the last frame, one line per subsystem
+void printFrameReport(const ShaderStats& frameShaderStats, const GLStateStats& frameStateStats) {
+	const std::vector<Model*>& models = assetRegistry.getModels();
+	RenderStats& renderStats = renderQueue.stats;
+
+	size_t totalBytes = 0;
+	for (unsigned int i = 0; i < models.size(); i++) {
+		MeshStats stats = models[i]->getStats();
+		totalBytes += stats.vertexBytes + stats.indexBytes;
+	}
+
+	std::ostringstream report;
+	report.precision(3);
+	report << "Frame at " << lastFrame << "s: " << getVertexFormatName() << ", " << totalBytes / (1024.0f * 1024.0f) << "MB of geometry" << std::endl
+		<< "    shaders:    " << frameShaderStats.uniformUpdates << " uniforms, " << frameShaderStats.uniformLookups + frameShaderStats.driverLookups << " lookups" << std::endl
+		<< "    frustum:    " << frustumCuller.stats.visible << " visible, " << sceneBVH.size() - frustumCuller.stats.visible << " culled (" << sceneBVH.stats.nodesVisited << " BVH nodes, " << frustumCuller.stats.milliseconds << "ms)" << std::endl
+		<< "    occlusion:  " << occlusionCuller.stats.occluded << " occluded by " << occlusionCuller.stats.occluders << " occluders (" << occlusionCuller.stats.triangles << " tris, " << occlusionCuller.stats.rasterMilliseconds + occlusionCuller.stats.testMilliseconds << "ms)" << std::endl
+		<< "    queries:    " << occlusionQueries.stats.queries << " queries, " << renderStats.conditionalDraws << " conditional draws (" << occlusionQueries.stats.skippedDraws << " skipped, " << occlusionQueries.stats.skippedTriangles << " tris)" << std::endl
+		<< "    LODs:       " << lodSelector.stats.copies[0];
+
+	for (unsigned int lod = 1; lod < MAX_LODS; lod++)
+		report << "/" << lodSelector.stats.copies[lod];
+
+	report << " (" << lodSelector.stats.triangles << " of " << lodSelector.stats.fullTriangles << " tris)" << std::endl
+		<< "    meshlets:   " << meshletCuller.stats.tested << " tested, " << meshletCuller.stats.frustumCulled << " outside, " << meshletCuller.stats.coneCulled << " facing away (" << meshletCuller.stats.culledTriangles << " tris)" << std::endl
+		<< "    submission: " << renderStats.draws << " draws (" << renderStats.multiDraws << " multi, " << renderStats.commands << " commands, " << renderStats.instances << " instances), " << renderStats.stateChanges() << " state changes, " << renderStats.milliseconds << "ms submit" << std::endl
+		<< "    GL state:   " << frameStateStats.issued << " calls (" << frameStateStats.elided << " elided)" << std::endl;
+
+	std::cout << report.str();
+}
+
+
+std::string getVertexFormatName() {
+	std::string name = vertexPrecision == VertexPrecision::QUANTIZED ? "quantized" : "float";
+	name += vertexLayout == VertexLayout::INTERLEAVED ? " interleaved" : " planar";
+
+	return name;
 }
 
 
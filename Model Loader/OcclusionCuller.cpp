@@ -0,0 +1,327 @@
+#include "OcclusionCuller.h"
+
+#include <xmmintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+unsigned int clipNearPlane(const glm::vec4 triangle[3], glm::vec4 polygon[4]);
+glm::vec3 toDepthBuffer(const glm::vec4& clip);
+
+
+///////////////////////////////////////////////////
+// Global Vars
+const unsigned int DEPTH_WIDTH = 256; // multiple of 4, rows are processed four pixels at a time
+const unsigned int DEPTH_HEIGHT = 128;
+const unsigned int MAX_OCCLUDERS = 8;
+const size_t MAX_OCCLUDER_TRIANGLES = 4096;
+const float MIN_OCCLUDER_SIZE = 0.1f; // bounding radius over distance to the camera
+
+unsigned int numBands = std::max(1u, std::min(4u, std::thread::hardware_concurrency())); // band 0 is rasterized by the calling thread
+
+
+const std::vector<CullItem>& OcclusionCuller::cull(const std::vector<CullItem>& items, const glm::mat4& viewProjection) {
+	stats = OcclusionStats();
+	if (!enabled)
+		return items;
+
+	auto start = std::chrono::steady_clock::now();
+
+	depthBuffer.assign(DEPTH_WIDTH * DEPTH_HEIGHT, 1.0f);
+	triangles.clear();
+
+	///////////////////////////////////////////////////
+	// Choose the occluders by their size on screen
+	// blended meshes can be seen through, and dense meshes cost more to rasterize than they save
+	std::vector<std::pair<float, const CullItem*>> candidates;
+
+	for (const CullItem& item : items) {
+		const Mesh& mesh = *item.mesh;
+		size_t numTriangles = mesh.vecData.elementCount() / 3;
+
+		if (mesh.isBlended() || numTriangles == 0 || numTriangles > MAX_OCCLUDER_TRIANGLES)
+			continue;
+
+		float scale = std::max(glm::length(glm::vec3(item.transform[0])), std::max(glm::length(glm::vec3(item.transform[1])), glm::length(glm::vec3(item.transform[2]))));
+		glm::vec4 centre = viewProjection * item.transform * glm::vec4(mesh.bounds.centre, 1.0f);
+		float size = mesh.bounds.radius * scale / std::max(centre.w, 0.001f);
+
+		if (size >= MIN_OCCLUDER_SIZE)
+			candidates.push_back(std::make_pair(size, &item));
+	}
+
+	// ties are broken by submission order so the same occluders are picked every run
+	size_t numOccluders = std::min<size_t>(MAX_OCCLUDERS, candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + numOccluders, candidates.end(), [](const std::pair<float, const CullItem*>& a, const std::pair<float, const CullItem*>& b) {
+		return a.first != b.first ? a.first > b.first : a.second < b.second;
+	});
+
+	for (size_t i = 0; i < numOccluders; i++)
+		addOccluder(*candidates[i].second, viewProjection);
+
+	if (!triangles.empty())
+		rasterize();
+
+	stats.occluders = numOccluders;
+	stats.triangles = triangles.size();
+	stats.rasterMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	///////////////////////////////////////////////////
+	// Test the screen bounds of every item
+	start = std::chrono::steady_clock::now();
+
+	visible.clear();
+	for (const CullItem& item : items) {
+		if (triangles.empty() || !isOccluded(item, viewProjection))
+			visible.push_back(item);
+	}
+
+	stats.tested = items.size();
+	stats.occluded = items.size() - visible.size();
+	stats.testMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return visible;
+}
+
+void OcclusionCuller::release() {
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		stopping = true;
+	}
+	workStarted.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	workers.clear();
+	stopping = false;
+}
+
+
+// moves the occluder triangles into the depth buffer, clipped against the near plane
+void OcclusionCuller::addOccluder(const CullItem& item, const glm::mat4& viewProjection) {
+	const VecData& vecData = item.mesh->vecData;
+	glm::mat4 transform = viewProjection * item.transform;
+
+	clipVertices.resize(vecData.vertices.size());
+	for (size_t i = 0; i < vecData.vertices.size(); i++)
+		clipVertices[i] = transform * glm::vec4(vecData.vertices[i], 1.0f);
+
+	size_t numElements = vecData.elementCount();
+
+	for (size_t i = 0; i + 2 < numElements; i += 3) {
+		glm::vec4 triangle[3];
+		for (int j = 0; j < 3; j++)
+			triangle[j] = clipVertices[vecData.indices.empty() ? i + j : vecData.indices[i + j]];
+
+		glm::vec4 polygon[4];
+		unsigned int numVertices = clipNearPlane(triangle, polygon);
+
+		for (unsigned int j = 1; j + 1 < numVertices; j++) {
+			OccluderTriangle occluderTriangle;
+			occluderTriangle.vertices[0] = toDepthBuffer(polygon[0]);
+			occluderTriangle.vertices[1] = toDepthBuffer(polygon[j]);
+			occluderTriangle.vertices[2] = toDepthBuffer(polygon[j + 1]);
+			triangles.push_back(occluderTriangle);
+		}
+	}
+}
+
+// wakes the workers for the other bands and waits until every band is done
+void OcclusionCuller::rasterize() {
+	if (workers.empty()) {
+		for (unsigned int band = 1; band < numBands; band++)
+			workers.push_back(std::thread(&OcclusionCuller::workerThread, this, band));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		pendingBands = workers.size();
+		frame++;
+	}
+	workStarted.notify_all();
+
+	rasterizeBand(0);
+
+	std::unique_lock<std::mutex> lock(workerMutex);
+	workFinished.wait(lock, [this] { return pendingBands == 0; });
+}
+
+// draws every occluder triangle into the rows of one band, keeping the nearest depth
+void OcclusionCuller::rasterizeBand(unsigned int band) {
+	int rowsPerBand = (DEPTH_HEIGHT + numBands - 1) / numBands;
+	float firstRow = (float)(band * rowsPerBand);
+	float lastRow = (float)std::min<int>(DEPTH_HEIGHT, (band + 1) * rowsPerBand) - 1.0f;
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 pixelCentres = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (const OccluderTriangle& triangle : triangles) {
+		glm::vec3 v0 = triangle.vertices[0];
+		glm::vec3 v1 = triangle.vertices[1];
+		glm::vec3 v2 = triangle.vertices[2];
+
+		// both windings are drawn, occluders may be open surfaces such as walls
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+		if (area < 0.0f) {
+			std::swap(v1, v2);
+			area = -area;
+		}
+
+		if (area <= 0.0f)
+			continue;
+
+		// clamped as floats first, vertices can be far outside the buffer
+		float minX = std::max(0.0f, floorf(std::min(v0.x, std::min(v1.x, v2.x))));
+		float maxX = std::min(DEPTH_WIDTH - 1.0f, ceilf(std::max(v0.x, std::max(v1.x, v2.x))));
+		float minY = std::max(firstRow, floorf(std::min(v0.y, std::min(v1.y, v2.y))));
+		float maxY = std::min(lastRow, ceilf(std::max(v0.y, std::max(v1.y, v2.y))));
+
+		if (minX > maxX || minY > maxY)
+			continue;
+
+		///////////////////////////////////////////////////
+		// Edge functions E(x, y) = Ax + By + C, each positive on the inside of an edge
+		// the edge opposite a vertex weights its depth, so depth is also a plane in x and y
+		glm::vec3 a = glm::vec3(v1.y - v2.y, v2.y - v0.y, v0.y - v1.y);
+		glm::vec3 b = glm::vec3(v2.x - v1.x, v0.x - v2.x, v1.x - v0.x);
+		glm::vec3 c = glm::vec3(v1.x * v2.y - v1.y * v2.x, v2.x * v0.y - v2.y * v0.x, v0.x * v1.y - v0.y * v1.x);
+		glm::vec3 depths = glm::vec3(v0.z, v1.z, v2.z) / area;
+
+		__m128 a0 = _mm_set1_ps(a.x), a1 = _mm_set1_ps(a.y), a2 = _mm_set1_ps(a.z);
+		__m128 depthA = _mm_set1_ps(glm::dot(a, depths));
+		float depthB = glm::dot(b, depths);
+		float depthC = glm::dot(c, depths);
+
+		for (int y = (int)minY; y <= (int)maxY; y++) {
+			float pixelY = y + 0.5f;
+			__m128 rowE0 = _mm_set1_ps(b.x * pixelY + c.x);
+			__m128 rowE1 = _mm_set1_ps(b.y * pixelY + c.y);
+			__m128 rowE2 = _mm_set1_ps(b.z * pixelY + c.z);
+			__m128 rowDepth = _mm_set1_ps(depthB * pixelY + depthC);
+
+			for (int x = (int)minX & ~3; x <= (int)maxX; x += 4) {
+				__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), pixelCentres);
+
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, pixelX), rowE0);
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, pixelX), rowE1);
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, pixelX), rowE2);
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				float* pixels = &depthBuffer[y * DEPTH_WIDTH + x];
+				__m128 depth = _mm_loadu_ps(pixels);
+				__m128 nearest = _mm_min_ps(depth, _mm_add_ps(_mm_mul_ps(depthA, pixelX), rowDepth));
+
+				_mm_storeu_ps(pixels, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth)));
+			}
+		}
+	}
+}
+
+void OcclusionCuller::workerThread(unsigned int band) {
+	unsigned int lastFrame = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(workerMutex);
+			workStarted.wait(lock, [&] { return stopping || frame != lastFrame; });
+
+			if (stopping)
+				return;
+
+			lastFrame = frame;
+		}
+
+		rasterizeBand(band);
+
+		{
+			std::lock_guard<std::mutex> lock(workerMutex);
+			pendingBands--;
+		}
+		workFinished.notify_one();
+	}
+}
+
+// hidden when every pixel under the screen rectangle of the box is nearer than its nearest corner
+bool OcclusionCuller::isOccluded(const CullItem& item, const glm::mat4& viewProjection) {
+	glm::vec3 centre, extent;
+	transformBounds(item.mesh->bounds, item.transform, centre, extent);
+
+	glm::vec2 screenMin = glm::vec2(FLT_MAX);
+	glm::vec2 screenMax = glm::vec2(-FLT_MAX);
+	float nearestDepth = FLT_MAX;
+
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner = centre + extent * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+		glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+		// boxes reaching past the near plane surround the camera
+		if (clip.z < -clip.w)
+			return false;
+
+		glm::vec3 position = toDepthBuffer(clip);
+		screenMin = glm::min(screenMin, glm::vec2(position.x, position.y));
+		screenMax = glm::max(screenMax, glm::vec2(position.x, position.y));
+		nearestDepth = std::min(nearestDepth, position.z);
+	}
+
+	float minX = std::max(0.0f, floorf(screenMin.x));
+	float maxX = std::min(DEPTH_WIDTH - 1.0f, ceilf(screenMax.x) - 1.0f);
+	float minY = std::max(0.0f, floorf(screenMin.y));
+	float maxY = std::min(DEPTH_HEIGHT - 1.0f, ceilf(screenMax.y) - 1.0f);
+
+	if (minX > maxX || minY > maxY)
+		return false;
+
+	const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	__m128 boxDepth = _mm_set1_ps(nearestDepth);
+	__m128 rectMin = _mm_set1_ps(minX);
+	__m128 rectMax = _mm_set1_ps(maxX);
+
+	for (int y = (int)minY; y <= (int)maxY; y++) {
+		for (int x = (int)minX & ~3; x <= (int)maxX; x += 4) {
+			__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+			__m128 inRect = _mm_and_ps(_mm_cmpge_ps(pixelX, rectMin), _mm_cmple_ps(pixelX, rectMax));
+			__m128 depth = _mm_loadu_ps(&depthBuffer[y * DEPTH_WIDTH + x]);
+
+			// one pixel that is not nearer than the box is enough to see it
+			if (_mm_movemask_ps(_mm_and_ps(inRect, _mm_cmpge_ps(depth, boxDepth))) != 0)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Sutherland-Hodgman against z >= -w, a triangle leaves at most 4 vertices
+unsigned int clipNearPlane(const glm::vec4 triangle[3], glm::vec4 polygon[4]) {
+	unsigned int numVertices = 0;
+
+	for (int i = 0; i < 3; i++) {
+		const glm::vec4& a = triangle[i];
+		const glm::vec4& b = triangle[(i + 1) % 3];
+		float distanceA = a.z + a.w;
+		float distanceB = b.z + b.w;
+
+		if (distanceA >= 0.0f)
+			polygon[numVertices++] = a;
+		if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+			polygon[numVertices++] = a + (b - a) * (distanceA / (distanceA - distanceB));
+	}
+
+	return numVertices;
+}
+
+// clip space to buffer pixels (rows from the bottom), keeping NDC depth
+glm::vec3 toDepthBuffer(const glm::vec4& clip) {
+	glm::vec3 ndc = glm::vec3(clip) / clip.w;
+	return glm::vec3((ndc.x * 0.5f + 0.5f) * DEPTH_WIDTH, (ndc.y * 0.5f + 0.5f) * DEPTH_HEIGHT, ndc.z);
+}
@@ -0,0 +1,72 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+
+
+///////////////////////////////////////////////////
+// Occlusion Culler
+// A low resolution depth buffer on the CPU, filled each frame with the
+// triangles of the largest visible opaque meshes (the occluders). Every mesh
+// that passed the frustum test then has the screen rectangle of its world box
+// compared against it, and is dropped when every depth under the rectangle is
+// nearer than the nearest corner of the box.
+// The rows of the buffer are split into bands that worker threads rasterize
+// four pixels at a time with SSE. A pixel is only ever written by the thread
+// owning its band, so the result does not depend on the thread count (or on
+// the GPU).
+
+// An occluder triangle after near plane clipping (x and y in buffer pixels, z NDC depth)
+struct OccluderTriangle {
+	glm::vec3 vertices[3];
+};
+
+// Counters for the last culled frame
+struct OcclusionStats {
+	unsigned int occluders = 0;
+	unsigned int triangles = 0;
+	unsigned int tested = 0;
+	unsigned int occluded = 0;
+	double rasterMilliseconds = 0.0;	// occluder setup and rasterization
+	double testMilliseconds = 0.0;
+};
+
+
+class OcclusionCuller {
+public:
+	OcclusionStats stats;
+	bool enabled = true;
+
+	// picks the occluders from the items, returns the items they do not hide
+	const std::vector<CullItem>& cull(const std::vector<CullItem>& items, const glm::mat4& viewProjection);
+
+	// stops the worker threads (call before exiting)
+	void release();
+private:
+	std::vector<float> depthBuffer;			// nearest NDC depth of each pixel, 1 where nothing was drawn
+	std::vector<glm::vec4> clipVertices;	// vertices of the occluder being added
+	std::vector<OccluderTriangle> triangles;
+	std::vector<CullItem> visible;
+
+	std::vector<std::thread> workers;
+	std::mutex workerMutex;
+	std::condition_variable workStarted;
+	std::condition_variable workFinished;
+	unsigned int frame = 0;			// incremented to start the workers on a new frame
+	unsigned int pendingBands = 0;
+	bool stopping = false;
+
+	void addOccluder(const CullItem& item, const glm::mat4& viewProjection);
+	void rasterize();
+	void rasterizeBand(unsigned int band);
+	void workerThread(unsigned int band);
+	bool isOccluded(const CullItem& item, const glm::mat4& viewProjection);
+};
+
+#endif
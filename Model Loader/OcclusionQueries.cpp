@@ -0,0 +1,253 @@
+#include "OcclusionQueries.h"
+#include "ShaderRegistry.h"
+#include "GLState.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+bool crossesNearPlane(const glm::vec3& centre, const glm::vec3& extent, const glm::mat4& viewProjection);
+
+
+///////////////////////////////////////////////////
+// Global Vars
+const std::string BOX_VERTEX_SHADER = "shaders/bounds.vs";
+const std::string BOX_FRAGMENT_SHADER = "shaders/bounds.fs";
+const unsigned int RETEST_INTERVAL = 8; // frames between queries of a visible entry
+
+OcclusionQueries occlusionQueries;
+
+
+bool OcclusionQueries::isSupported() {
+	if (supported < 0)
+		supported = GLEW_VERSION_3_3 || GLEW_ARB_occlusion_query2;
+
+	return supported == 1;
+}
+
+void OcclusionQueries::begin(const glm::mat4& view, const glm::mat4& projection) {
+	stats = QueryStats();
+	viewProjection = projection * view;
+	frame++;
+
+	readResults();
+}
+
+GLuint OcclusionQueries::getQuery(const CullItem& item, unsigned int lod) {
+	// blended meshes are drawn after the boxes and never hide anything
+	if (!enabled || !isSupported() || item.mesh->isBlended())
+		return 0;
+
+	glm::vec3 centre, extent;
+	transformBounds(item.mesh->bounds, item.transform, centre, extent);
+
+	if (crossesNearPlane(centre, extent, viewProjection))
+		return 0;
+
+	ItemKey key;
+	key.mesh = item.mesh;
+	key.transform = item.transform;
+
+	// new entries start visible, their first tests are spread over the interval
+	auto found = entries.find(key);
+	if (found == entries.end()) {
+		QueryEntry entry;
+		entry.nextTest = frame + entries.size() % RETEST_INTERVAL;
+		found = entries.insert(std::make_pair(key, entry)).first;
+	}
+
+	QueryEntry& entry = found->second;
+	entry.lastSeen = frame;
+
+	if (!entry.occluded && frame < entry.nextTest)
+		return 0;
+
+	///////////////////////////////////////////////////
+	// Queue the box with a query from the pool
+	GLuint query = 0;
+	if (freeQueries.empty())
+		glGenQueries(1, &query);
+	else {
+		query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+
+	BoxQuery box;
+	box.query = query;
+	box.centre = centre;
+	box.extent = extent;
+	boxes.push_back(box);
+
+	PendingQuery pendingQuery;
+	pendingQuery.query = query;
+	pendingQuery.key = key;
+	pendingQuery.conditional = entry.occluded;
+	pendingQuery.triangles = item.mesh->stats.lodTriangles[lod];
+	pending.push_back(pendingQuery);
+
+	stats.queries++;
+
+	if (!entry.occluded) {
+		entry.nextTest = frame + RETEST_INTERVAL;
+		return 0;
+	}
+
+	return query;
+}
+
+void OcclusionQueries::drawBoxes() {
+	if (boxes.empty())
+		return;
+
+	if (boxShader == NULL)
+		setupBox();
+
+	// boxes only test depth, filled even in wireframe mode so their faces count
+	GLenum polygonMode = glState.getPolygonMode();
+
+	glState.useProgram(boxShader->ID);
+	glState.bindVertexArray(boxVertexArray);
+	glState.polygonMode(GL_FILL);
+	glState.depthMask(false);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+	// a visible mesh tested after its own draw lies on or inside its box
+	glDepthFunc(GL_LEQUAL);
+
+	for (const BoxQuery& box : boxes) {
+		glm::mat4 boxTransform = glm::translate(glm::mat4(1.0f), box.centre);
+		boxTransform = glm::scale(boxTransform, glm::max(box.extent, glm::vec3(0.0001f)));
+		boxTransformUniform.set(viewProjection * boxTransform);
+
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, box.query);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+	}
+
+	glDepthFunc(GL_LESS);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glState.depthMask(true);
+	glState.polygonMode(polygonMode);
+
+	boxes.clear();
+}
+
+void OcclusionQueries::end() {
+	stats.occluded = 0;
+
+	for (auto it = entries.begin(); it != entries.end(); ) {
+		if (it->second.lastSeen != frame)
+			it = entries.erase(it);
+		else {
+			if (it->second.occluded)
+				stats.occluded++;
+			it++;
+		}
+	}
+}
+
+void OcclusionQueries::release() {
+	for (const PendingQuery& pendingQuery : pending)
+		freeQueries.push_back(pendingQuery.query);
+
+	if (!freeQueries.empty())
+		glDeleteQueries(freeQueries.size(), &freeQueries[0]);
+
+	if (boxVertexArray) {
+		GLuint buffers[] = { boxVertexBuffer, boxIndexBuffer };
+		glDeleteBuffers(2, buffers);
+		glDeleteVertexArrays(1, &boxVertexArray);
+	}
+
+	entries.clear();
+	pending.clear();
+	freeQueries.clear();
+	boxes.clear();
+	boxShader = NULL;
+	boxVertexArray = boxVertexBuffer = boxIndexBuffer = 0;
+}
+
+
+// applies every result the GPU has finished, stopping at the first that is not ready
+void OcclusionQueries::readResults() {
+	while (!pending.empty()) {
+		PendingQuery& pendingQuery = pending.front();
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(pendingQuery.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+
+		GLuint anySamples = 0;
+		glGetQueryObjectuiv(pendingQuery.query, GL_QUERY_RESULT, &anySamples);
+
+		auto found = entries.find(pendingQuery.key);
+		if (found != entries.end()) {
+			QueryEntry& entry = found->second;
+
+			// a copy that appears again waits a full interval before its next test
+			if (entry.occluded && anySamples)
+				entry.nextTest = frame + RETEST_INTERVAL;
+
+			entry.occluded = !anySamples;
+		}
+
+		if (pendingQuery.conditional && !anySamples) {
+			stats.skippedDraws++;
+			stats.skippedTriangles += pendingQuery.triangles;
+		}
+
+		stats.resultsRead++;
+		freeQueries.push_back(pendingQuery.query);
+		pending.pop_front();
+	}
+}
+
+// unit cube and the program drawing it, created the first time boxes are drawn
+void OcclusionQueries::setupBox() {
+	boxShader = shaderRegistry.getShader(BOX_VERTEX_SHADER, BOX_FRAGMENT_SHADER);
+	boxTransformUniform = boxShader->getUniform<glm::mat4>("boxTransform");
+
+	const glm::vec3 corners[8] = {
+		glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, -1.0f), glm::vec3(-1.0f, 1.0f, -1.0f),
+		glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(-1.0f, 1.0f, 1.0f)
+	};
+
+	const GLushort indices[36] = {
+		0, 2, 1, 0, 3, 2,	// -z
+		4, 5, 6, 4, 6, 7,	// +z
+		0, 1, 5, 0, 5, 4,	// -y
+		3, 7, 6, 3, 6, 2,	// +y
+		0, 4, 7, 0, 7, 3,	// -x
+		1, 2, 6, 1, 6, 5	// +x
+	};
+
+	glGenVertexArrays(1, &boxVertexArray);
+	glGenBuffers(1, &boxVertexBuffer);
+	glGenBuffers(1, &boxIndexBuffer);
+
+	glState.bindVertexArray(boxVertexArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, boxVertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxIndexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+}
+
+
+bool crossesNearPlane(const glm::vec3& centre, const glm::vec3& extent, const glm::mat4& viewProjection) {
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner = centre + extent * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+		glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+		if (clip.z < -clip.w)
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,102 @@
+#ifndef OCCLUSIONQUERIES_H
+#define OCCLUSIONQUERIES_H
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "FrustumCuller.h"
+
+
+///////////////////////////////////////////////////
+// Occlusion Queries
+// GPU visibility for the meshes left after CPU culling. Each mesh copy keeps
+// whether its last query found it hidden. Hidden copies have their bounding
+// box drawn with an occlusion query once the visible opaque meshes are in the
+// depth buffer, and their real draw is made conditional on that query, so the
+// GPU skips it without the CPU waiting for the result. Visible copies are only
+// re-tested every few frames (temporal coherence). Results are read back in
+// later frames, once the GPU has made them available, to move copies between
+// the two states.
+// Boxes crossing the near plane are never tested, their front faces would be
+// clipped away.
+
+struct QueryEntry {
+	bool occluded = false;		// the newest result found no samples
+	unsigned int nextTest = 0;	// frame a visible entry is queried again
+	unsigned int lastSeen = 0;	// entries not submitted in a frame are dropped
+};
+
+// A query the GPU has not returned yet (queries complete in the order they were issued)
+struct PendingQuery {
+	GLuint query;
+	ItemKey key;
+	bool conditional;		// the real draw was conditional on this query
+	unsigned int triangles;	// of the level of detail drawn
+};
+
+// A box to be drawn with its query this frame
+struct BoxQuery {
+	GLuint query;
+	glm::vec3 centre;
+	glm::vec3 extent;
+};
+
+// Counters for the last frame
+struct QueryStats {
+	unsigned int queries = 0;			// boxes drawn with a query
+	unsigned int resultsRead = 0;
+	unsigned int skippedDraws = 0;		// conditional draws whose result came back with no samples
+	unsigned int skippedTriangles = 0;
+	unsigned int occluded = 0;			// entries currently hidden
+};
+
+
+class OcclusionQueries {
+public:
+	QueryStats stats;
+	bool enabled = true;
+
+	// occlusion queries and conditional rendering (GL 3.3 for GL_ANY_SAMPLES_PASSED)
+	bool isSupported();
+
+	// reads the results the GPU has finished and starts a new frame
+	void begin(const glm::mat4& view, const glm::mat4& projection);
+
+	// queues a box query for the item when it is due, returns the query its draw must be conditional on (0 to draw it normally)
+	GLuint getQuery(const CullItem& item, unsigned int lod);
+
+	// draws the queued boxes, called by the render queue once the unconditional opaque meshes are drawn
+	void drawBoxes();
+
+	// drops the entries that were not submitted this frame
+	void end();
+
+	// deletes the queries and box geometry (call before the context is destroyed)
+	void release();
+private:
+	std::map<ItemKey, QueryEntry> entries;
+	std::vector<BoxQuery> boxes;
+	std::deque<PendingQuery> pending;
+	std::vector<GLuint> freeQueries;
+
+	Shader* boxShader = NULL;
+	Uniform<glm::mat4> boxTransformUniform;
+	GLuint boxVertexArray = 0;
+	GLuint boxVertexBuffer = 0;
+	GLuint boxIndexBuffer = 0;
+
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	unsigned int frame = 0;
+	int supported = -1;
+
+	void readResults();
+	void setupBox();
+};
+
+extern OcclusionQueries occlusionQueries;
+
+#endif
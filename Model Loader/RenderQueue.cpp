@@ -0,0 +1,322 @@
+#include "RenderQueue.h"
+#include "Hash.h"
+#include "GLState.h"
+#include "OcclusionQueries.h"
+#include "MeshletCuller.h"
+
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+bool sameTextures(const Mesh& a, const Mesh& b);
+bool sameMaterial(const Mesh& a, const Mesh& b);
+bool canMultiDraw(const Mesh& a, const Mesh& b);
+uint64_t packBits(uint64_t value, unsigned int bits);
+
+
+void RenderQueue::begin(const glm::mat4& view, const glm::mat4& projection, float farPlane) {
+	this->view = view;
+	this->projection = projection;
+	this->farPlane = farPlane;
+
+	items.clear();
+}
+
+void RenderQueue::submit(Mesh& mesh, const glm::mat4& transform, GLuint query, unsigned int lod) {
+	mesh.instanced = true;
+	if (!mesh.prepareShader())
+		return;
+
+	// distance along the view direction to the mesh origin
+	float depth = -(view * transform[3]).z;
+
+	DrawItem item;
+	item.key = makeSortKey(mesh, depth, query != 0);
+	item.mesh = &mesh;
+	item.transform = transform;
+	item.query = query;
+	item.lod = std::min(lod, mesh.getLodCount() - 1);
+
+	items.push_back(item);
+}
+
+void RenderQueue::flush() {
+	auto start = std::chrono::steady_clock::now();
+
+	stats = RenderStats();
+
+	std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+
+	buildRuns();
+	uploadInstances();
+
+	Mesh* lastMesh = NULL;
+	Shader* lastShader = NULL;
+	GLuint lastVertexArray = 0;
+	bool blending = false;
+	bool boxesDrawn = false;
+
+	for (unsigned int r = 0; r < runs.size(); ) {
+		Mesh& mesh = *items[runs[r].first].mesh;
+		GLuint query = items[runs[r].first].query;
+		unsigned int lod = items[runs[r].first].lod;
+
+		// occlusion query boxes are tested against every unconditional opaque mesh
+		if ((query || mesh.isBlended()) && !boxesDrawn) {
+			occlusionQueries.drawBoxes();
+			boxesDrawn = true;
+			lastShader = NULL;
+			lastVertexArray = 0;
+		}
+
+		// blended items come last, depth writes are disabled so they do not hide each other
+		if (mesh.isBlended() && !blending) {
+			glState.setEnabled(GL_BLEND, true);
+			glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glState.depthMask(false);
+			blending = true;
+		}
+
+		///////////////////////////////////////////////////
+		// Bind only the state that differs from the previous item
+		// (uniforms belong to the program, so a new program re-sets them all)
+		bool programChanged = mesh.getShader() != lastShader;
+		if (programChanged) {
+			mesh.getShader()->use();
+			lastShader = mesh.getShader();
+			stats.programChanges++;
+		}
+
+		if (programChanged || !sameTextures(mesh, *lastMesh)) {
+			mesh.bindTextures();
+			stats.textureChanges++;
+		}
+
+		// multi draws read the material from the draw data
+		if (!mesh.inArena() && (programChanged || !sameMaterial(mesh, *lastMesh))) {
+			mesh.bindMaterial();
+			stats.materialChanges++;
+		}
+
+		if (mesh.getVertexArray() != lastVertexArray) {
+			mesh.bindVertexArray();
+			lastVertexArray = mesh.getVertexArray();
+			stats.vertexArrayChanges++;
+		}
+
+		unsigned int count = 1;
+		unsigned int commands = runs[r].commandCount;
+
+		if (query)
+			glBeginConditionalRender(query, GL_QUERY_WAIT);
+
+		if (mesh.inArena()) {
+			// following runs sharing the program, textures and pool join the same multi draw (conditional runs are drawn alone)
+			while (!query && r + count < runs.size() && !items[runs[r + count].first].query && canMultiDraw(mesh, *items[runs[r + count].first].mesh)) {
+				commands += runs[r + count].commandCount;
+				count++;
+			}
+
+			// every meshlet of the runs may have been culled
+			if (commands > 0) {
+				mesh.setDrawOffset(runs[r].firstCommand);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(commandRing.getOffset() + runs[r].firstCommand * sizeof(DrawElementsIndirectCommand)), commands, 0);
+
+				stats.multiDraws++;
+				stats.draws++;
+			}
+		}
+		// without base instance support the attributes are pointed at the run instead
+		else if (baseInstanceSupported) {
+			mesh.bindInstanceBuffer(instanceRing.getBuffer(), instanceRing.getOffset());
+			mesh.drawGeometry(runs[r].count, runs[r].first, lod);
+			commands = 1;
+			stats.draws++;
+		}
+		else {
+			mesh.bindInstanceBuffer(instanceRing.getBuffer(), instanceRing.getOffset() + runs[r].first * sizeof(glm::mat4));
+			mesh.drawGeometry(runs[r].count, 0, lod);
+			commands = 1;
+			stats.draws++;
+		}
+
+		if (query) {
+			glEndConditionalRender();
+			stats.conditionalDraws++;
+		}
+
+		for (unsigned int i = r; i < r + count; i++) {
+			stats.instances += runs[i].count;
+			if (blending)
+				stats.blendedDraws++;
+		}
+
+		lastMesh = items[runs[r + count - 1].first].mesh;
+		stats.commands += commands;
+
+		r += count;
+	}
+
+	if (!boxesDrawn)
+		occlusionQueries.drawBoxes();
+
+	if (blending) {
+		glState.setEnabled(GL_BLEND, false);
+		glState.depthMask(true);
+	}
+
+	// the regions written this frame are reused once the GPU is past these draws
+	instanceRing.fence();
+	drawDataRing.fence();
+	commandRing.fence();
+
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RenderQueue::release() {
+	instanceRing.release();
+	drawDataRing.release();
+	commandRing.release();
+	initialised = false;
+}
+
+
+// opaque copies of a mesh sort next to each other and become one run drawn with instancing (one per level of detail),
+// blended items are a run each to keep them in depth order, conditional items to keep their own query
+void RenderQueue::buildRuns() {
+	runs.clear();
+
+	for (unsigned int first = 0; first < items.size(); ) {
+		DrawRun run;
+		run.first = first;
+		run.count = 1;
+
+		const DrawItem& item = items[first];
+		if (!item.mesh->isBlended() && !item.query) {
+			while (first + run.count < items.size() && items[first + run.count].mesh == item.mesh && items[first + run.count].lod == item.lod && !items[first + run.count].query)
+				run.count++;
+		}
+
+		runs.push_back(run);
+		first += run.count;
+	}
+}
+
+// writes the transform of every item, in draw order, into the instance ring,
+// and the commands and draw data of every run of an arena mesh
+void RenderQueue::uploadInstances() {
+	if (!initialised) {
+		baseInstanceSupported = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+		multiDrawSupported = geometryArena.isSupported();
+		initialised = true;
+	}
+
+	size_t transformBytes = items.size() * sizeof(glm::mat4);
+	glm::mat4* transforms = (glm::mat4*)instanceRing.map(transformBytes);
+
+	for (unsigned int i = 0; i < items.size(); i++)
+		transforms[i] = items[i].transform;
+
+	instanceRing.unmap();
+
+	if (!multiDrawSupported)
+		return;
+
+	///////////////////////////////////////////////////
+	// One command per run, or one per visible meshlet range of each copy, with draw data for each command
+	// (runs of meshes outside the arena have none)
+	drawCommands.clear();
+	drawData.clear();
+
+	for (unsigned int i = 0; i < runs.size(); i++) {
+		Mesh& mesh = *items[runs[i].first].mesh;
+		unsigned int lod = items[runs[i].first].lod;
+		runs[i].firstCommand = drawCommands.size();
+
+		if (!mesh.inArena())
+			continue;
+
+		if (meshletCuller.usesMeshlets(mesh, lod)) {
+			for (unsigned int item = runs[i].first; item < runs[i].first + runs[i].count; item++)
+				meshletCuller.cull(mesh, items[item].transform, item, drawCommands);
+		}
+		else
+			drawCommands.push_back(mesh.getDrawCommand(runs[i].count, runs[i].first, lod));
+
+		runs[i].commandCount = drawCommands.size() - runs[i].firstCommand;
+		drawData.resize(drawCommands.size(), mesh.getDrawData());
+	}
+
+	size_t commandBytes = drawCommands.size() * sizeof(DrawElementsIndirectCommand);
+	void* commands = commandRing.map(commandBytes);
+	if (commandBytes > 0)
+		memcpy(commands, &drawCommands[0], commandBytes);
+	commandRing.unmap();
+
+	size_t drawDataBytes = drawData.size() * sizeof(MeshDrawData);
+	void* data = drawDataRing.map(drawDataBytes);
+	if (drawDataBytes > 0)
+		memcpy(data, &drawData[0], drawDataBytes);
+	drawDataRing.unmap();
+
+	// nothing is drawn from a ring left empty this frame
+	if (commandBytes == 0)
+		return;
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandRing.getBuffer());
+
+	// the instance ring doubles as the transform storage buffer
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, TRANSFORM_BUFFER_BINDING, instanceRing.getBuffer(), instanceRing.getOffset(), transformBytes);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BUFFER_BINDING, drawDataRing.getBuffer(), drawDataRing.getOffset(), drawDataBytes);
+}
+
+
+uint64_t RenderQueue::makeSortKey(Mesh& mesh, float depth, bool conditional) {
+	// 16 bit depth, front to back
+	uint64_t depthBits = (uint64_t)(glm::clamp(depth / farPlane, 0.0f, 1.0f) * 65535.0f);
+
+	uint64_t textureSet = 0;
+	for (unsigned int i = 0; i < mesh.textures.size(); i++)
+		textureSet = hashCombine(textureSet, mesh.textures[i].id);
+
+	uint64_t state = packBits(mesh.getShader()->ID, 8) << 38
+		| packBits(textureSet, 12) << 26
+		| packBits(mesh.materialIndex, 12) << 14
+		| packBits(mesh.getVertexArray(), 14);
+
+	if (mesh.isBlended())
+		return 1ull << 63 | (65535 - depthBits) << 46 | state;
+
+	return (uint64_t)conditional << 62 | state << 16 | depthBits;
+}
+
+
+bool sameTextures(const Mesh& a, const Mesh& b) {
+	if (a.textures.size() != b.textures.size())
+		return false;
+
+	for (unsigned int i = 0; i < a.textures.size(); i++) {
+		if (a.textures[i].id != b.textures[i].id)
+			return false;
+	}
+
+	return true;
+}
+
+bool sameMaterial(const Mesh& a, const Mesh& b) {
+	return a.materialIndex == b.materialIndex;
+}
+
+// only the draw data may differ between the commands of one multi draw
+bool canMultiDraw(const Mesh& a, const Mesh& b) {
+	return b.inArena() && a.getShader() == b.getShader() && a.getVertexArray() == b.getVertexArray()
+		&& a.isBlended() == b.isBlended() && sameTextures(a, b);
+}
+
+// keeps the low bits of a value (ids wider than the field only affect the order, never the result)
+uint64_t packBits(uint64_t value, unsigned int bits) {
+	return value & ((1ull << bits) - 1);
+}
@@ -0,0 +1,112 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "StreamRing.h"
+
+
+///////////////////////////////////////////////////
+// Render Queue
+// Meshes are submitted as draw items each frame and drawn in the order of a
+// packed 64-bit sort key, so meshes sharing a program, textures and material
+// are drawn together and only the state that differs is re-bound.
+//
+//   opaque:  0 | conditional (1) | program (8) | textures (12) | material (12) | vertex array (14) | depth (16)
+//   blended: 1 | inverted depth (16) | program (8) | textures (12) | material (12) | vertex array (14)
+//
+// Opaque items are drawn first, front to back, then blended items back to front.
+// Opaque items submitted with an occlusion query are drawn after the others,
+// each under conditional rendering, once the query boxes have been drawn.
+// Every item's transform is written to an instance buffer, and opaque copies of
+// the same mesh at the same level of detail are drawn together with a single
+// instanced draw call (levels follow distance, so depth order keeps them together).
+// Meshes in the geometry arena are drawn with glMultiDrawElementsIndirect
+// instead: consecutive runs sharing a program, textures and pool become one
+// call, with transforms and materials read from storage buffers. Copies of a
+// mesh split into meshlets get a command for each range of meshlets the
+// meshlet culler leaves visible, so a run may own any number of commands.
+// Transforms, draw data and commands are streamed through persistently mapped
+// rings (StreamRing.h), so filling them never waits on or reallocates a buffer.
+
+// storage buffer bindings used by the MULTI_DRAW shader variant
+const GLuint TRANSFORM_BUFFER_BINDING = 0;
+const GLuint DRAW_DATA_BUFFER_BINDING = 1;
+
+struct DrawItem {
+	uint64_t key;
+	Mesh* mesh;
+	glm::mat4 transform;
+	GLuint query;	// the draw is skipped by the GPU when this query found no samples (0 for none)
+	unsigned int lod;	// level of detail drawn, 0 for the full mesh
+};
+
+// consecutive sorted items drawn by one instanced draw or by multi draw commands
+struct DrawRun {
+	unsigned int first;
+	unsigned int count;
+	unsigned int firstCommand = 0;	// commands of the run in the command buffer (arena meshes only)
+	unsigned int commandCount = 0;
+};
+
+// Counters for the last flushed frame
+struct RenderStats {
+	unsigned int draws = 0;			// draw calls
+	unsigned int multiDraws = 0;	// draw calls that were glMultiDrawElementsIndirect
+	unsigned int commands = 0;		// instanced draws, counting each multi draw command
+	unsigned int instances = 0;		// items drawn by those calls
+	unsigned int blendedDraws = 0;
+	unsigned int conditionalDraws = 0;
+	unsigned int programChanges = 0;
+	unsigned int textureChanges = 0;
+	unsigned int materialChanges = 0;
+	unsigned int vertexArrayChanges = 0;
+	double milliseconds = 0.0;	// CPU time spent sorting and submitting
+
+	unsigned int stateChanges() const { return programChanges + textureChanges + materialChanges + vertexArrayChanges; }
+};
+
+
+class RenderQueue {
+public:
+	RenderStats stats;
+
+	// starts a frame, depth is measured along the view direction up to farPlane
+	void begin(const glm::mat4& view, const glm::mat4& projection, float farPlane);
+
+	// meshes whose shader variant is still compiling are skipped
+	void submit(Mesh& mesh, const glm::mat4& transform, GLuint query = 0, unsigned int lod = 0);
+
+	// sorts and draws every submitted item
+	void flush();
+
+	// deletes the instance, draw data and command rings (call before the context is destroyed)
+	void release();
+
+	size_t size() const { return items.size(); }
+private:
+	std::vector<DrawItem> items;
+	std::vector<DrawRun> runs;
+	std::vector<DrawElementsIndirectCommand> drawCommands;
+	std::vector<MeshDrawData> drawData;
+
+	StreamRing instanceRing = StreamRing(GL_ARRAY_BUFFER);	// item transforms, in draw order
+	StreamRing drawDataRing = StreamRing(GL_SHADER_STORAGE_BUFFER);
+	StreamRing commandRing = StreamRing(GL_DRAW_INDIRECT_BUFFER);
+	bool initialised = false;
+	bool baseInstanceSupported = false;
+	bool multiDrawSupported = false;
+
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	float farPlane = 1.0f;
+
+	void buildRuns();
+	void uploadInstances();
+	uint64_t makeSortKey(Mesh& mesh, float depth, bool conditional);
+};
+
+#endif
@@ -0,0 +1,433 @@
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+float getSurfaceArea(const glm::vec3& min, const glm::vec3& max);
+
+
+///////////////////////////////////////////////////
+// Global Vars
+const unsigned int SAH_BINS = 12;
+const unsigned int MAX_LEAF_OBJECTS = 4;
+const float TRAVERSAL_COST = 1.0f; // relative to testing one object
+
+
+void SceneBVH::build(const std::vector<SceneObject>& sceneObjects) {
+	auto start = std::chrono::steady_clock::now();
+
+	objects = sceneObjects;
+	for (unsigned int i = 0; i < objects.size(); i++)
+		updateBox(objects[i]);
+
+	objectIndices.resize(objects.size());
+	for (unsigned int i = 0; i < objectIndices.size(); i++)
+		objectIndices[i] = i;
+
+	nodes.clear();
+	stats = BVHStats();
+
+	if (!objects.empty()) {
+		nodes.reserve(objects.size() * 2);
+
+		BVHNode root;
+		root.first = 0;
+		root.count = objects.size();
+		nodes.push_back(root);
+
+		subdivide(0, 1);
+	}
+
+	stats.nodes = nodes.size();
+	stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SceneBVH::setTransform(unsigned int object, const glm::mat4& transform) {
+	objects[object].transform = transform;
+	updateBox(objects[object]);
+}
+
+// children always follow their parent, so walking backwards updates them first
+void SceneBVH::refit() {
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = (int)nodes.size() - 1; i >= 0; i--) {
+		BVHNode& node = nodes[i];
+
+		if (node.count > 0) {
+			node.min = glm::vec3(FLT_MAX);
+			node.max = glm::vec3(-FLT_MAX);
+
+			for (unsigned int j = node.first; j < node.first + node.count; j++) {
+				node.min = glm::min(node.min, objects[objectIndices[j]].min);
+				node.max = glm::max(node.max, objects[objectIndices[j]].max);
+			}
+		}
+		else {
+			node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+			node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+		}
+	}
+
+	stats.refitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SceneBVH::cullFrustum(FrustumCuller& culler) {
+	stats.nodesVisited = 0;
+	if (nodes.empty())
+		return;
+
+	const Frustum& frustum = culler.getFrustum();
+
+	std::vector<unsigned int> stack;
+	stack.push_back(0);
+
+	while (!stack.empty()) {
+		unsigned int index = stack.back();
+		const BVHNode& node = nodes[index];
+		stack.pop_back();
+		stats.nodesVisited++;
+
+		///////////////////////////////////////////////////
+		// Classify the node box against every plane
+		glm::vec3 centre = (node.min + node.max) * 0.5f;
+		glm::vec3 extent = (node.max - node.min) * 0.5f;
+
+		bool outside = false;
+		bool crossing = false;
+
+		for (int p = 0; p < 6 && !outside; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			float distance = glm::dot(glm::vec3(plane), centre) + plane.w;
+			float reach = glm::dot(glm::abs(glm::vec3(plane)), extent);
+
+			if (distance < -reach)
+				outside = true;
+			else if (distance < reach)
+				crossing = true;
+		}
+
+		if (outside)
+			continue;
+
+		if (!crossing) {
+			acceptSubtree(index, culler);
+			continue;
+		}
+
+		// objects in a crossing leaf are left to the SIMD test of the culler
+		if (node.count > 0) {
+			for (unsigned int i = node.first; i < node.first + node.count; i++) {
+				SceneObject& object = objects[objectIndices[i]];
+				culler.add(*object.mesh, object.transform);
+			}
+		}
+		else {
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+		}
+	}
+}
+
+bool SceneBVH::raycast(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) {
+	stats.trianglesTested = 0;
+	if (nodes.empty())
+		return false;
+
+	glm::vec3 inverseDirection = glm::vec3(1.0f) / direction;
+	bool found = false;
+	hit.distance = FLT_MAX;
+
+	std::vector<unsigned int> stack;
+	if (intersectBox(nodes[0].min, nodes[0].max, origin, inverseDirection, hit.distance) >= 0.0f)
+		stack.push_back(0);
+
+	while (!stack.empty()) {
+		const BVHNode& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.count > 0) {
+			for (unsigned int i = node.first; i < node.first + node.count; i++) {
+				if (raycastObject(objects[objectIndices[i]], origin, direction, hit)) {
+					hit.object = objectIndices[i];
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		// the nearer child is pushed last so it is visited first, and can shorten the ray for the other
+		float leftDistance = intersectBox(nodes[node.first].min, nodes[node.first].max, origin, inverseDirection, hit.distance);
+		float rightDistance = intersectBox(nodes[node.first + 1].min, nodes[node.first + 1].max, origin, inverseDirection, hit.distance);
+		unsigned int left = node.first;
+
+		if (leftDistance >= 0.0f && rightDistance >= 0.0f) {
+			stack.push_back(leftDistance < rightDistance ? left + 1 : left);
+			stack.push_back(leftDistance < rightDistance ? left : left + 1);
+		}
+		else if (leftDistance >= 0.0f)
+			stack.push_back(left);
+		else if (rightDistance >= 0.0f)
+			stack.push_back(left + 1);
+	}
+
+	if (found)
+		hit.position = origin + direction * hit.distance;
+
+	return found;
+}
+
+
+void SceneBVH::updateBox(SceneObject& object) {
+	glm::vec3 centre, extent;
+	transformBounds(object.mesh->bounds, object.transform, centre, extent);
+
+	object.min = centre - extent;
+	object.max = centre + extent;
+	object.inverseTransform = glm::inverse(object.transform);
+}
+
+// splits a node along the axis with the widest spread of box centres, at the cheapest of SAH_BINS planes
+void SceneBVH::subdivide(unsigned int nodeIndex, unsigned int depth) {
+	stats.depth = std::max(stats.depth, depth);
+
+	unsigned int first = nodes[nodeIndex].first;
+	unsigned int count = nodes[nodeIndex].count;
+
+	glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+	glm::vec3 centreMin(FLT_MAX), centreMax(-FLT_MAX);
+
+	for (unsigned int i = first; i < first + count; i++) {
+		const SceneObject& object = objects[objectIndices[i]];
+		glm::vec3 centre = (object.min + object.max) * 0.5f;
+
+		boxMin = glm::min(boxMin, object.min);
+		boxMax = glm::max(boxMax, object.max);
+		centreMin = glm::min(centreMin, centre);
+		centreMax = glm::max(centreMax, centre);
+	}
+
+	nodes[nodeIndex].min = boxMin;
+	nodes[nodeIndex].max = boxMax;
+
+	int axis = 0;
+	glm::vec3 spread = centreMax - centreMin;
+	if (spread.y > spread[axis])
+		axis = 1;
+	if (spread.z > spread[axis])
+		axis = 2;
+
+	// every centre in the same place, no plane can separate them
+	if (count <= 1 || spread[axis] <= 0.0f) {
+		stats.leaves++;
+		return;
+	}
+
+	///////////////////////////////////////////////////
+	// Bin the objects by their centre
+	struct Bin {
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+		unsigned int count = 0;
+	};
+
+	Bin bins[SAH_BINS];
+	float binScale = SAH_BINS / spread[axis];
+
+	auto getBin = [&](unsigned int object) {
+		float centre = (objects[object].min[axis] + objects[object].max[axis]) * 0.5f;
+		return std::min(SAH_BINS - 1, (unsigned int)((centre - centreMin[axis]) * binScale));
+	};
+
+	for (unsigned int i = first; i < first + count; i++) {
+		Bin& bin = bins[getBin(objectIndices[i])];
+		bin.min = glm::min(bin.min, objects[objectIndices[i]].min);
+		bin.max = glm::max(bin.max, objects[objectIndices[i]].max);
+		bin.count++;
+	}
+
+	///////////////////////////////////////////////////
+	// Sweep from both sides for the area and count left and right of each plane
+	float leftCost[SAH_BINS - 1];
+	glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+	unsigned int sweepCount = 0;
+
+	for (unsigned int i = 0; i < SAH_BINS - 1; i++) {
+		sweepMin = glm::min(sweepMin, bins[i].min);
+		sweepMax = glm::max(sweepMax, bins[i].max);
+		sweepCount += bins[i].count;
+		leftCost[i] = sweepCount > 0 ? sweepCount * getSurfaceArea(sweepMin, sweepMax) : 0.0f;
+	}
+
+	float bestCost = FLT_MAX;
+	unsigned int bestPlane = 0;
+	sweepMin = glm::vec3(FLT_MAX);
+	sweepMax = glm::vec3(-FLT_MAX);
+	sweepCount = 0;
+
+	for (unsigned int i = SAH_BINS - 1; i > 0; i--) {
+		sweepMin = glm::min(sweepMin, bins[i].min);
+		sweepMax = glm::max(sweepMax, bins[i].max);
+		sweepCount += bins[i].count;
+
+		float cost = leftCost[i - 1] + (sweepCount > 0 ? sweepCount * getSurfaceArea(sweepMin, sweepMax) : 0.0f);
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestPlane = i - 1;
+		}
+	}
+
+	// small nodes stay leaves unless the split is cheaper than testing every object
+	float area = getSurfaceArea(boxMin, boxMax);
+	float splitCost = TRAVERSAL_COST + (area > 0.0f ? bestCost / area : 0.0f);
+	if (count <= MAX_LEAF_OBJECTS && splitCost >= count) {
+		stats.leaves++;
+		return;
+	}
+
+	unsigned int* middle = std::partition(&objectIndices[first], &objectIndices[first] + count, [&](unsigned int object) { return getBin(object) <= bestPlane; });
+	unsigned int leftCount = middle - &objectIndices[first];
+
+	if (leftCount == 0 || leftCount == count) {
+		stats.leaves++;
+		return;
+	}
+
+	///////////////////////////////////////////////////
+	// Children are added as a pair
+	unsigned int left = nodes.size();
+
+	BVHNode child;
+	child.first = first;
+	child.count = leftCount;
+	nodes.push_back(child);
+
+	child.first = first + leftCount;
+	child.count = count - leftCount;
+	nodes.push_back(child);
+
+	nodes[nodeIndex].first = left;
+	nodes[nodeIndex].count = 0;
+
+	subdivide(left, depth + 1);
+	subdivide(left + 1, depth + 1);
+}
+
+void SceneBVH::acceptSubtree(unsigned int node, FrustumCuller& culler) {
+	std::vector<unsigned int> stack;
+	stack.push_back(node);
+
+	while (!stack.empty()) {
+		const BVHNode& current = nodes[stack.back()];
+		stack.pop_back();
+
+		if (current.count > 0) {
+			for (unsigned int i = current.first; i < current.first + current.count; i++) {
+				SceneObject& object = objects[objectIndices[i]];
+				culler.accept(*object.mesh, object.transform);
+			}
+		}
+		else {
+			stack.push_back(current.first);
+			stack.push_back(current.first + 1);
+		}
+	}
+}
+
+// tests the mesh triangles with the ray moved into object space (distances stay the same, the direction is not normalised)
+bool SceneBVH::raycastObject(const SceneObject& object, const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) {
+	if (intersectBox(object.min, object.max, origin, glm::vec3(1.0f) / direction, hit.distance) < 0.0f)
+		return false;
+
+	glm::vec3 localOrigin = glm::vec3(object.inverseTransform * glm::vec4(origin, 1.0f));
+	glm::vec3 localDirection = glm::vec3(object.inverseTransform * glm::vec4(direction, 0.0f));
+
+	const VecData& vecData = object.mesh->vecData;
+	const std::vector<MeshPart>& parts = object.mesh->parts;
+	glm::vec3 localInverseDirection = glm::vec3(1.0f) / localDirection;
+	bool found = false;
+
+	// the parts of a batched mesh are tested separately, skipping those whose own box the ray misses
+	for (size_t p = 0; p < std::max<size_t>(parts.size(), 1); p++) {
+		size_t first = 0, last = vecData.elementCount();
+
+		if (!parts.empty()) {
+			if (intersectBox(parts[p].bounds.min, parts[p].bounds.max, localOrigin, localInverseDirection, hit.distance) < 0.0f)
+				continue;
+
+			first = parts[p].firstIndex;
+			last = first + parts[p].triangleCount * 3;
+		}
+
+		for (size_t i = first; i + 2 < last; i += 3) {
+			const glm::vec3& a = vecData.vertices[vecData.indices.empty() ? i : vecData.indices[i]];
+			const glm::vec3& b = vecData.vertices[vecData.indices.empty() ? i + 1 : vecData.indices[i + 1]];
+			const glm::vec3& c = vecData.vertices[vecData.indices.empty() ? i + 2 : vecData.indices[i + 2]];
+
+			float distance = intersectTriangle(localOrigin, localDirection, a, b, c);
+			stats.trianglesTested++;
+
+			if (distance >= 0.0f && distance < hit.distance) {
+				hit.distance = distance;
+				hit.triangle = i;
+				hit.part = (unsigned int)p;
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+
+float intersectBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+	glm::vec3 t1 = (min - origin) * inverseDirection;
+	glm::vec3 t2 = (max - origin) * inverseDirection;
+
+	glm::vec3 entries = glm::min(t1, t2);
+	glm::vec3 exits = glm::max(t1, t2);
+
+	float entry = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+	float exit = std::min(std::min(exits.x, exits.y), exits.z);
+
+	if (entry > exit || entry >= maxDistance)
+		return -1.0f;
+
+	return entry;
+}
+
+float intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	const float EPSILON = 1e-9f;
+
+	glm::vec3 edge1 = b - a;
+	glm::vec3 edge2 = c - a;
+	glm::vec3 p = glm::cross(direction, edge2);
+	float determinant = glm::dot(edge1, p);
+
+	// parallel to the triangle (both sides are hit, so back faces can be picked)
+	if (fabsf(determinant) < EPSILON)
+		return -1.0f;
+
+	float inverseDeterminant = 1.0f / determinant;
+	glm::vec3 s = origin - a;
+
+	float u = glm::dot(s, p) * inverseDeterminant;
+	if (u < 0.0f || u > 1.0f)
+		return -1.0f;
+
+	glm::vec3 q = glm::cross(s, edge1);
+	float v = glm::dot(direction, q) * inverseDeterminant;
+	if (v < 0.0f || u + v > 1.0f)
+		return -1.0f;
+
+	return glm::dot(edge2, q) * inverseDeterminant;
+}
+
+float getSurfaceArea(const glm::vec3& min, const glm::vec3& max) {
+	glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
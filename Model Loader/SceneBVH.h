@@ -0,0 +1,91 @@
+#ifndef SCENEBVH_H
+#define SCENEBVH_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "FrustumCuller.h"
+
+
+///////////////////////////////////////////////////
+// Scene BVH
+// Bounding volume hierarchy over the world space boxes of every mesh in the
+// scene, built top down with binned SAH. Nodes are stored depth first in one
+// array, with both children of a node next to each other after it, so a refit
+// only walks the array backwards once. When transforms change the boxes are
+// refitted instead of rebuilt.
+// The hierarchy answers frustum queries (whole subtrees are accepted or
+// rejected by a single box test) and ray casts against the mesh triangles.
+
+struct SceneObject {
+	Mesh* mesh;
+	glm::mat4 transform;
+	glm::mat4 inverseTransform;	// rays are tested against the triangles in object space
+	glm::vec3 min, max;			// world space box
+	unsigned int model;			// index of the model the mesh belongs to
+};
+
+struct BVHNode {
+	glm::vec3 min, max;
+	unsigned int first;	// leaf: first entry in objectIndices, inner node: left child (right child is first + 1)
+	unsigned int count;	// objects in a leaf, 0 for inner nodes
+};
+
+struct RayHit {
+	float distance = 0.0f;		// along the ray direction
+	unsigned int object = 0;	// index into the scene objects
+	unsigned int triangle = 0;	// index of the first vertex index of the triangle
+	unsigned int part = 0;		// part of a batched mesh the triangle belongs to (MeshPart)
+	glm::vec3 position = glm::vec3(0.0f);
+};
+
+// Counters for the last build/refit and query
+struct BVHStats {
+	unsigned int nodes = 0;
+	unsigned int leaves = 0;
+	unsigned int depth = 0;
+	double buildMilliseconds = 0.0;
+	double refitMilliseconds = 0.0;
+	unsigned int nodesVisited = 0;		// by the last frustum query
+	unsigned int trianglesTested = 0;	// by the last ray cast
+};
+
+
+class SceneBVH {
+public:
+	BVHStats stats;
+
+	void build(const std::vector<SceneObject>& sceneObjects);
+
+	// updates the transform of an object, call refit() once every transform is set
+	void setTransform(unsigned int object, const glm::mat4& transform);
+	void refit();
+
+	// objects whose node is fully inside the frustum are accepted without further tests,
+	// objects in nodes crossing a plane are added to the culler for the SIMD test
+	void cullFrustum(FrustumCuller& culler);
+
+	// nearest triangle hit by the ray, false if nothing is hit
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit);
+
+	const std::vector<SceneObject>& getObjects() const { return objects; }
+	size_t size() const { return objects.size(); }
+private:
+	std::vector<SceneObject> objects;
+	std::vector<unsigned int> objectIndices;	// leaves reference ranges of this array
+	std::vector<BVHNode> nodes;
+
+	void updateBox(SceneObject& object);
+	void subdivide(unsigned int node, unsigned int depth);
+	void acceptSubtree(unsigned int node, FrustumCuller& culler);
+	bool raycastObject(const SceneObject& object, const glm::vec3& origin, const glm::vec3& direction, RayHit& hit);
+};
+
+// slab test, returns the entry distance or a negative value when the box is missed (or behind a closer hit)
+float intersectBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance);
+
+// Moller-Trumbore, returns the distance along the ray or a negative value
+float intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+
+#endif
@@ -1,8 +1,16 @@
 #include "Shader.h"
+#include "ShaderCache.h"
+#include "GLState.h"
+
+#include <vector>
+#include <algorithm>
 
 int success;
 char infoLog[512];
 
+ShaderStats shaderStats;
+bool parallelCompile = false;
+
 Shader::Shader() {};
 
 Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath) {
@@ -31,61 +39,232 @@ Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath) {
 		std::cout << "ERROR->" << __FUNCTION__ << ": Error reading shader files" << std::endl;
 	}
 
+	compile(vertexCode, fragmentCode);
+};
+
+
+// Compiles and links the program from source, or loads it from the program binary cache
+void Shader::compile(const std::string& vertexCode, const std::string& fragmentCode) {
+	compileAsync(vertexCode, fragmentCode);
+	finishCompile();
+}
+
+// Submits the compile and link without waiting for the driver, poll isReady to finish it
+void Shader::compileAsync(const std::string& vertexCode, const std::string& fragmentCode) {
+	cacheKey = getProgramKey(vertexCode, fragmentCode);
+	ready = false;
+	fromCache = false;
+
+	ID = glCreateProgram();
+	if (loadProgramBinary(ID, cacheKey)) {
+		loadUniforms();
+		ready = fromCache = true;
+		return;
+	}
+
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
 
 	///////////////////////////////////////////////////////
-	// Compile shaders
-	unsigned int vertex, fragment;
-
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	compileShader(vertex, vShaderCode);
+	// Compile shaders (the status is only checked once the link has finished)
+	vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vShaderCode, NULL);
+	glCompileShader(vertexShader);
 
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	compileShader(fragment, fShaderCode);		
+	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
+	glCompileShader(fragmentShader);
 		
 	///////////////////////////////////////////////////////
-	// Create shader program
-	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
+	// Link shader program
+	if (programBinariesSupported())
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	glAttachShader(ID, vertexShader);
+	glAttachShader(ID, fragmentShader);
 	glLinkProgram(ID);
+}
+
+// Returns false while the driver is still compiling, never blocks
+bool Shader::isReady() {
+	if (ready)
+		return true;
+
+	// without parallel compile the status cannot be checked without waiting
+	if (!parallelCompileSupported())
+		return false;
+
+	GLint completed = GL_FALSE;
+	glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+	if (!completed)
+		return false;
+
+	finishCompile();
+	return true;
+}
+
+// Waits for the link, then reports errors, stores the binary and reads the uniforms
+void Shader::finishCompile() {
+	if (ready)
+		return;
+
+	checkCompileStatus(vertexShader);
+	checkCompileStatus(fragmentShader);
 
 	glGetProgramiv(ID, GL_LINK_STATUS, &success);
 	if (!success) {
 		glGetProgramInfoLog(ID, 512, NULL, infoLog);
 		std::cout << "ERROR->" << __FUNCTION__ << ": Could not link program" << std::endl << infoLog << std::endl;;
 	}
+	else
+		saveProgramBinary(ID, cacheKey);
 
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
-};
+	glDetachShader(ID, vertexShader);
+	glDetachShader(ID, fragmentShader);
+
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+	vertexShader = fragmentShader = 0;
+
+	loadUniforms();
+	ready = true;
+}
 
 
 // Activates shader program
 void Shader::use() {
-	glUseProgram(ID);
+	glState.useProgram(ID);
 };
 
 void Shader::setVec3(const std::string& name, glm::vec3& value) {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	getUniform<glm::vec3>(name).set(value);
 }
 
 void Shader::setVec4(const std::string& name, glm::vec4& value) {
-	glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	getUniform<glm::vec4>(name).set(value);
 }
 
 void Shader::setFloat(const std::string& name, float value) {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	getUniform<float>(name).set(value);
 }
 
-void Shader::compileShader(unsigned int& shader, const char* shaderCode) {
-	glShaderSource(shader, 1, &shaderCode, NULL);
-	glCompileShader(shader);
-
+void Shader::checkCompileStatus(unsigned int shader) {
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 	if (!success) {
 		glGetShaderInfoLog(shader, 512, NULL, infoLog);
 		std::cout << "ERROR->" << __FUNCTION__ << ": Could not load shader" << std::endl << infoLog << std::endl;
 	}
-}
\ No newline at end of file
+}
+
+
+// Builds the uniform table from the linked program
+void Shader::loadUniforms() {
+	uniforms.clear();
+
+	GLint numUniforms = 0, maxNameLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &numUniforms);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<GLchar> nameBuffer(std::max(maxNameLength, 1));
+
+	for (GLint i = 0; i < numUniforms; i++) {
+		GLsizei nameLength = 0;
+		UniformInfo info;
+
+		glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &info.size, &info.type, &nameBuffer[0]);
+
+		std::string name(&nameBuffer[0], nameLength);
+
+		info.location = glGetUniformLocation(ID, name.c_str());
+		shaderStats.driverLookups++;
+
+		// uniform blocks members have no location
+		if (info.location < 0)
+			continue;
+
+		// arrays are reported as "name[0]", store them under both names
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			uniforms[name.substr(0, name.size() - 3)] = info;
+
+		uniforms[name] = info;
+	}
+
+	// GLSL 330 has no binding layout for blocks
+	GLuint cameraBlock = glGetUniformBlockIndex(ID, "Camera");
+	if (cameraBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, cameraBlock, CAMERA_BLOCK_BINDING);
+
+	GLuint materialBlock = glGetUniformBlockIndex(ID, "Materials");
+	if (materialBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, materialBlock, MATERIAL_BLOCK_BINDING);
+}
+
+const UniformInfo* Shader::findUniform(const std::string& name) const {
+	shaderStats.uniformLookups++;
+
+	auto found = uniforms.find(name);
+	if (found == uniforms.end())
+		return NULL;
+
+	return &found->second;
+}
+
+bool Shader::uniformTypeMatches(GLenum type, GLenum requested) {
+	if (type == requested)
+		return true;
+
+	// samplers and bools are set through integers
+	if (requested == GL_INT)
+		return type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_2D_ARRAY;
+
+	return false;
+}
+
+
+void setUniformValue(GLint location, int value) {
+	glUniform1i(location, value);
+}
+
+void setUniformValue(GLint location, float value) {
+	glUniform1f(location, value);
+}
+
+void setUniformValue(GLint location, const glm::vec3& value) {
+	glUniform3fv(location, 1, &value[0]);
+}
+
+void setUniformValue(GLint location, const glm::vec4& value) {
+	glUniform4fv(location, 1, &value[0]);
+}
+
+void setUniformValue(GLint location, const glm::mat4& value) {
+	glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+}
+
+void initParallelCompile() {
+	// loaded by hand, as older glew builds do not know the extension
+	typedef void (APIENTRY *MaxShaderCompilerThreadsProc)(GLuint count);
+	MaxShaderCompilerThreadsProc maxShaderCompilerThreads = NULL;
+
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+		maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+		maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+
+	// 0xFFFFFFFF lets the driver pick the number of threads
+	if (maxShaderCompilerThreads)
+		maxShaderCompilerThreads(0xFFFFFFFF);
+
+	parallelCompile = maxShaderCompilerThreads != NULL;
+}
+
+bool parallelCompileSupported() {
+	return parallelCompile;
+}
+
+
+template<> GLenum getUniformType<int>() { return GL_INT; }
+template<> GLenum getUniformType<float>() { return GL_FLOAT; }
+template<> GLenum getUniformType<glm::vec3>() { return GL_FLOAT_VEC3; }
+template<> GLenum getUniformType<glm::vec4>() { return GL_FLOAT_VEC4; }
+template<> GLenum getUniformType<glm::mat4>() { return GL_FLOAT_MAT4; }
@@ -9,6 +9,80 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
+#include <cstdint>
+
+// GL_KHR_parallel_shader_compile (same value as the ARB extension)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+
+///////////////////////////////////////////////////
+// DataTypes
+struct UniformInfo {
+	GLint location;
+	GLenum type;
+	GLint size;	// number of array elements
+};
+
+// Counts uniform traffic, reset by the caller (once per frame)
+struct ShaderStats {
+	unsigned int uniformUpdates = 0;	// glUniform* calls
+	unsigned int uniformLookups = 0;	// by-name lookups in the uniform table
+	unsigned int driverLookups = 0;		// glGetUniformLocation calls
+};
+
+extern ShaderStats shaderStats;
+
+// uniform blocks shared by every program, bound by name when a program is linked or loaded
+const GLuint CAMERA_BLOCK_BINDING = 0;		// FrameUniforms.h
+const GLuint MATERIAL_BLOCK_BINDING = 1;	// MaterialTable.h
+
+// enables driver side compile threads (KHR/ARB_parallel_shader_compile), call once after glewInit
+// and before any program is requested, so the first compiles already get the threads
+void initParallelCompile();
+
+// true if initParallelCompile found the extension and programs compile in the background
+bool parallelCompileSupported();
+
+
+///////////////////////////////////////////////////
+// Typed uniform values (the program must be bound when setting them)
+void setUniformValue(GLint location, int value);
+void setUniformValue(GLint location, float value);
+void setUniformValue(GLint location, const glm::vec3& value);
+void setUniformValue(GLint location, const glm::vec4& value);
+void setUniformValue(GLint location, const glm::mat4& value);
+
+template<typename T> GLenum getUniformType();
+template<> GLenum getUniformType<int>();
+template<> GLenum getUniformType<float>();
+template<> GLenum getUniformType<glm::vec3>();
+template<> GLenum getUniformType<glm::vec4>();
+template<> GLenum getUniformType<glm::mat4>();
+
+// Uniform handle, resolved once from the program's uniform table
+template<typename T>
+class Uniform {
+public:
+	GLint location = -1;
+
+	Uniform() {}
+	explicit Uniform(GLint location) : location(location) {}
+
+	void set(const T& value) const {
+		// uniforms removed by the compiler resolve to -1 and are skipped
+		if (location < 0)
+			return;
+
+		setUniformValue(location, value);
+		shaderStats.uniformUpdates++;
+	}
+
+	bool isValid() const { return location >= 0; }
+};
+
 
 class Shader {
 public:
@@ -17,12 +91,44 @@ public:
 	Shader();
 	Shader(const GLchar* vertexPath, const GLchar* fragmentPath);
 	
+	void compile(const std::string& vertexCode, const std::string& fragmentCode);
+	void compileAsync(const std::string& vertexCode, const std::string& fragmentCode);
+	bool isReady();
+	void finishCompile();
+	bool isFromCache() const { return fromCache; }	// loaded from the program binary cache instead of compiled
 	void use();
 	void setVec3(const std::string &name, glm::vec3 &value);
 	void setVec4(const std::string& name, glm::vec4& value);
 	void setFloat(const std::string &name, float value);
+
+	// resolves a handle through the uniform table, without asking the driver
+	template<typename T>
+	Uniform<T> getUniform(const std::string& name) const {
+		const UniformInfo* info = findUniform(name);
+		if (!info)
+			return Uniform<T>();
+
+		if (!uniformTypeMatches(info->type, getUniformType<T>()))
+			std::cout << "WARN->" << __FUNCTION__ << ": Uniform '" << name << "' does not match the requested type" << std::endl;
+
+		return Uniform<T>(info->location);
+	}
+
+	const std::unordered_map<std::string, UniformInfo>& getUniforms() const { return uniforms; }
 private:
-	void compileShader(unsigned int& shader, const char* shaderCode);
+	std::unordered_map<std::string, UniformInfo> uniforms;
+
+	// state of a compile submitted with compileAsync
+	bool ready = false;
+	bool fromCache = false;
+	unsigned int vertexShader = 0;
+	unsigned int fragmentShader = 0;
+	uint64_t cacheKey = 0;
+
+	void checkCompileStatus(unsigned int shader);
+	void loadUniforms();
+	const UniformInfo* findUniform(const std::string& name) const;
+	static bool uniformTypeMatches(GLenum type, GLenum requested);
 };
 
 #endif
\ No newline at end of file
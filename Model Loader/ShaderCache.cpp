@@ -0,0 +1,127 @@
+#include "ShaderCache.h"
+#include "FileUtils.h"
+#include "Hash.h"
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+
+
+///////////////////////////////////////////////////
+// DataTypes
+const uint32_t SHADER_CACHE_MAGIC = 0x534D454A; // "JEMS"
+const uint32_t SHADER_CACHE_FORMAT_VERSION = 1;
+
+struct ProgramBinaryHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	GLenum format;
+	uint32_t length;
+};
+
+ProgramCacheStats programCacheStats;
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+std::string getProgramCachePath(uint64_t key);
+
+
+uint64_t getProgramKey(const std::string& vertexCode, const std::string& fragmentCode) {
+	uint64_t key = hashCombine(hashString(vertexCode), hashString(fragmentCode));
+
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (unsigned int i = 0; i < 3; i++) {
+		const GLubyte* value = glGetString(driverStrings[i]);
+		key = hashCombine(key, hashString(value ? (const char*)value : ""));
+	}
+
+	return key;
+}
+
+bool loadProgramBinary(GLuint program, uint64_t key) {
+	if (!programBinariesSupported())
+		return false;
+
+	std::string cachePath = getProgramCachePath(key);
+	std::vector<char> blob;
+	ProgramBinaryHeader header;
+
+	if (!readFileBytes(cachePath, blob) || blob.size() < sizeof(header)) {
+		programCacheStats.misses++;
+		return false;
+	}
+
+	memcpy(&header, blob.data(), sizeof(header));
+	if (header.magic != SHADER_CACHE_MAGIC || header.version != SHADER_CACHE_FORMAT_VERSION || header.key != key
+		|| header.length != blob.size() - sizeof(header)) {
+		programCacheStats.misses++;
+		return false;
+	}
+
+	glProgramBinary(program, header.format, blob.data() + sizeof(header), header.length);
+
+	// drivers reject binaries from other builds, the caller falls back to compiling the source
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		std::cout << "WARN->" << __FUNCTION__ << ": Cached program binary was rejected by the driver, compiling from source" << std::endl;
+		programCacheStats.rejected++;
+		return false;
+	}
+
+	touchFile(cachePath);
+	programCacheStats.hits++;
+
+	return true;
+}
+
+void saveProgramBinary(GLuint program, uint64_t key) {
+	if (!programBinariesSupported())
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	ProgramBinaryHeader header = { SHADER_CACHE_MAGIC, SHADER_CACHE_FORMAT_VERSION, key, 0, 0 };
+	std::vector<char> blob(sizeof(header) + length);
+
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &header.format, blob.data() + sizeof(header));
+	if (written <= 0)
+		return;
+
+	header.length = (uint32_t)written;
+	blob.resize(sizeof(header) + written);
+	memcpy(blob.data(), &header, sizeof(header));
+
+	std::string cachePath = getProgramCachePath(key);
+	if (!writeFileAtomic(cachePath, blob)) {
+		std::cout << "WARN->" << __FUNCTION__ << ": Could not write cache file '" << cachePath << "'" << std::endl;
+		return;
+	}
+
+	evictOldestFiles(SHADER_CACHE_DIR, SHADER_CACHE_MAX_BYTES);
+}
+
+bool programBinariesSupported() {
+	static int supported = -1;
+
+	if (supported < 0) {
+		GLint numFormats = 0;
+		if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+
+		supported = numFormats > 0;
+	}
+
+	return supported == 1;
+}
+
+
+std::string getProgramCachePath(uint64_t key) {
+	return SHADER_CACHE_DIR + "/" + hashToHex(key) + ".bin";
+}
@@ -0,0 +1,39 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <GL/glew.h>
+#include <string>
+#include <cstdint>
+
+
+///////////////////////////////////////////////////
+// Program Binary Cache
+// Linked programs are stored in cache/shaders with glGetProgramBinary, named
+// after a hash of the shader source and the GL vendor/renderer/version, so a
+// driver update never receives a binary built by another driver.
+
+const std::string SHADER_CACHE_DIR = "cache/shaders";
+const uintmax_t SHADER_CACHE_MAX_BYTES = 64ull * 1024 * 1024;
+
+struct ProgramCacheStats {
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int rejected = 0;	// binaries the driver would not link
+};
+
+extern ProgramCacheStats programCacheStats;
+
+
+// key for a program, includes the driver strings of the current context
+uint64_t getProgramKey(const std::string& vertexCode, const std::string& fragmentCode);
+
+// links the program from a cached binary, returns false on a miss or if the driver rejects it
+bool loadProgramBinary(GLuint program, uint64_t key);
+
+// stores a linked program (it must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+void saveProgramBinary(GLuint program, uint64_t key);
+
+// false if the context cannot save or load program binaries
+bool programBinariesSupported();
+
+#endif
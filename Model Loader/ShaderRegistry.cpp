@@ -0,0 +1,181 @@
+#include "ShaderRegistry.h"
+#include "FileUtils.h"
+#include "Hash.h"
+
+#include <chrono>
+#include <algorithm>
+
+
+ShaderRegistry shaderRegistry;
+
+
+Shader* ShaderRegistry::getShader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines) {
+	Shader* shader = requestShader(vertexPath, fragmentPath, defines);
+	finish(shader);
+
+	return shader;
+}
+
+Shader* ShaderRegistry::requestShader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines) {
+	const std::string& vertexSource = getSource(vertexPath);
+	const std::string& fragmentSource = getSource(fragmentPath);
+
+	uint64_t key = hashCombine(hashString(vertexSource), hashString(fragmentSource));
+	for (unsigned int i = 0; i < defines.size(); i++)
+		key = hashCombine(key, hashString(defines[i]));
+
+	auto found = programs.find(key);
+	if (found != programs.end()) {
+		stats.programsShared++;
+		return found->second;
+	}
+
+	///////////////////////////////////////////////////
+	// First use of this program
+	auto start = std::chrono::steady_clock::now();
+
+	Shader* shader = new Shader();
+	shader->compileAsync(insertDefines(vertexSource, defines), insertDefines(fragmentSource, defines));
+
+	if (!shader->isReady())
+		pending.push_back(shader);
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (shader->isFromCache()) {
+		stats.programsLoaded++;
+		stats.loadMilliseconds += milliseconds;
+	}
+	else {
+		stats.programsCompiled++;
+		stats.compileMilliseconds += milliseconds;
+	}
+
+	programs[key] = shader;
+
+	return shader;
+}
+
+Shader* ShaderRegistry::getVariant(unsigned int features) {
+	Shader* shader = requestVariant(features);
+	finish(shader);
+
+	return shader;
+}
+
+Shader* ShaderRegistry::requestVariant(unsigned int features) {
+	auto found = variants.find(features);
+	if (found != variants.end()) {
+		stats.programsShared++;
+		return found->second;
+	}
+
+	return variants[features] = requestShader(MESH_VERTEX_SHADER, MESH_FRAGMENT_SHADER, getFeatureDefines(features));
+}
+
+void ShaderRegistry::update() {
+	if (pending.empty())
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+
+	if (parallelCompileSupported()) {
+		for (unsigned int i = 0; i < pending.size(); ) {
+			if (pending[i]->isReady())
+				pending.erase(pending.begin() + i);
+			else
+				i++;
+		}
+	}
+	else if (!pending.empty()) {
+		// finishing blocks, so only the oldest program is finished per call
+		pending.front()->finishCompile();
+		pending.erase(pending.begin());
+	}
+
+	stats.compileMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ShaderRegistry::finishAll() {
+	while (!pending.empty())
+		finish(pending.back());
+}
+
+// blocks until the program is linked
+void ShaderRegistry::finish(Shader* shader) {
+	auto found = std::find(pending.begin(), pending.end(), shader);
+	if (found == pending.end())
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+
+	shader->finishCompile();
+	pending.erase(found);
+
+	stats.compileMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ShaderRegistry::clear() {
+	for (auto it = programs.begin(); it != programs.end(); it++) {
+		glDeleteProgram(it->second->ID);
+		delete it->second;
+	}
+
+	programs.clear();
+	variants.clear();
+	pending.clear();
+	sources.clear();
+}
+
+
+std::vector<std::string> getFeatureDefines(unsigned int features) {
+	std::vector<std::string> defines;
+
+	if (features & SHADER_TEXTURED)
+		defines.push_back("TEXTURED");
+	if (features & SHADER_ALPHA_MAPPED)
+		defines.push_back("ALPHA_MAPPED");
+	if (features & SHADER_VERTEX_COLOUR)
+		defines.push_back("VERTEX_COLOUR");
+	if (features & SHADER_QUANTIZED)
+		defines.push_back("QUANTIZED");
+	if (features & SHADER_INSTANCED)
+		defines.push_back("INSTANCED");
+	if (features & SHADER_MULTI_DRAW)
+		defines.push_back("MULTI_DRAW");
+	if (features & SHADER_LIT)
+		defines.push_back("LIT");
+
+	return defines;
+}
+
+const std::string& ShaderRegistry::getSource(const std::string& path) {
+	auto found = sources.find(path);
+	if (found != sources.end())
+		return found->second;
+
+	std::vector<char> contents;
+	if (!readFileBytes(path, contents))
+		std::cout << "ERROR->" << __FUNCTION__ << ": Error reading shader file '" << path << "'" << std::endl;
+
+	return sources[path] = std::string(contents.begin(), contents.end());
+}
+
+
+std::string insertDefines(const std::string& source, const std::vector<std::string>& defines) {
+	if (defines.empty())
+		return source;
+
+	std::string defineBlock;
+	for (unsigned int i = 0; i < defines.size(); i++)
+		defineBlock += "#define " + defines[i] + "\n";
+
+	// #version has to stay the first statement
+	size_t insertAt = 0;
+	if (source.compare(0, 8, "#version") == 0) {
+		insertAt = source.find('\n');
+		insertAt = insertAt == std::string::npos ? source.size() : insertAt + 1;
+	}
+
+	return source.substr(0, insertAt) + defineBlock + source.substr(insertAt);
+}
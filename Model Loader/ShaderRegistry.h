@@ -0,0 +1,87 @@
+#ifndef SHADERREGISTRY_H
+#define SHADERREGISTRY_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Shader.h"
+
+
+///////////////////////////////////////////////////
+// Shader Features
+// Each feature is injected into the mesh shaders as a #define, so a mesh binds a
+// variant compiled for exactly what it uses instead of branching at runtime.
+enum ShaderFeature {
+	SHADER_TEXTURED = 1 << 0,		// samples texture_diffuse1
+	SHADER_ALPHA_MAPPED = 1 << 1,	// alpha from texture_alpha1 (map_d)
+	SHADER_VERTEX_COLOUR = 1 << 2,	// colour attribute instead of the material diffuse
+	SHADER_QUANTIZED = 1 << 3,		// positions rebuilt from positionScale/positionOffset
+	SHADER_INSTANCED = 1 << 4,		// model matrix read from the instance attribute
+	SHADER_MULTI_DRAW = 1 << 5,		// model matrix and material index read from storage buffers by gl_DrawID
+	SHADER_LIT = 1 << 6				// Blinn-Phong shading from the normal attribute (materials with illum 1 or 2)
+};
+
+const std::string MESH_VERTEX_SHADER = "shaders/shader.vs";
+const std::string MESH_FRAGMENT_SHADER = "shaders/shader.fs";
+
+std::vector<std::string> getFeatureDefines(unsigned int features);
+
+
+///////////////////////////////////////////////////
+// Shader Registry
+// Programs are keyed by a hash of their vertex/fragment source and defines, so
+// each distinct program is compiled once and shared by every model using it.
+// Shader files are also only read from disk once.
+// Programs can be requested without waiting for them, in which case they are
+// compiled by the driver in the background (GL_KHR_parallel_shader_compile)
+// and finished by update(). Without the extension update() finishes one
+// program per call, so the wait is spread over several frames.
+
+struct ShaderRegistryStats {
+	unsigned int programsCompiled = 0;	// built from source
+	unsigned int programsLoaded = 0;	// loaded from the program binary cache (ShaderCache.h)
+	unsigned int programsShared = 0;	// requests served by an existing program
+	double compileMilliseconds = 0.0;	// time the caller was blocked submitting/finishing programs built from source
+	double loadMilliseconds = 0.0;		// time spent loading programs from the binary cache
+
+	double totalMilliseconds() const { return compileMilliseconds + loadMilliseconds; }
+};
+
+
+class ShaderRegistry {
+public:
+	ShaderRegistryStats stats;
+
+	// defines are inserted after the #version line as "#define <define>"
+	Shader* getShader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {});
+	Shader* requestShader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {});
+
+	// mesh shader variant for a set of ShaderFeature flags, compiled the first time it is requested
+	Shader* getVariant(unsigned int features);
+	Shader* requestVariant(unsigned int features);
+
+	// finishes programs the driver has completed (call once per frame)
+	void update();
+	void finishAll();
+	size_t pendingCount() const { return pending.size(); }
+
+	// deletes every program (call before the context is destroyed)
+	void clear();
+	size_t size() const { return programs.size(); }
+private:
+	std::unordered_map<uint64_t, Shader*> programs;
+	std::unordered_map<unsigned int, Shader*> variants; // features -> program, skips hashing the source
+	std::unordered_map<std::string, std::string> sources; // file path -> contents
+	std::vector<Shader*> pending; // submitted but not finished
+
+	const std::string& getSource(const std::string& path);
+	void finish(Shader* shader);
+};
+
+std::string insertDefines(const std::string& source, const std::vector<std::string>& defines);
+
+extern ShaderRegistry shaderRegistry;
+
+#endif
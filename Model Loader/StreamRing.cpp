@@ -0,0 +1,122 @@
+#include "StreamRing.h"
+
+#include <algorithm>
+
+
+///////////////////////////////////////////////////
+// Global Vars
+const GLuint64 FENCE_TIMEOUT = 1000000000; // ns, the wait is retried until the GPU is done
+
+
+void* StreamRing::map(size_t bytes) {
+	if (buffer == 0) {
+		persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+		// regions start where a uniform or storage buffer range may start
+		GLint uniformAlignment = 1, storageAlignment = 1;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		if (GLEW_VERSION_4_3 || GLEW_ARB_shader_storage_buffer_object)
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+
+		alignment = std::max<size_t>(16, std::max(uniformAlignment, storageAlignment));
+
+		if (!persistent)
+			glGenBuffers(1, &buffer);
+	}
+
+	if (!persistent) {
+		if (staging.size() < bytes)
+			staging.resize(bytes);
+		stagedBytes = bytes;
+		return staging.data();
+	}
+
+	region = (region + 1) % STREAM_FRAMES;
+
+	// an empty frame still gets a region, so the buffer can always be bound
+	if (buffer == 0 || bytes > regionSize)
+		allocate(std::max(bytes, alignment));
+
+	waitForRegion(region);
+
+	return mapped + region * regionSize;
+}
+
+void StreamRing::unmap() {
+	// the persistent mapping is coherent, writes are visible to the draws that follow
+	if (persistent)
+		return;
+
+	// orphaned, so the driver never waits for the previous frame to finish with it
+	glBindBuffer(target, buffer);
+	glBufferData(target, stagedBytes, stagedBytes > 0 ? staging.data() : NULL, GL_STREAM_DRAW);
+	glBindBuffer(target, 0);
+}
+
+void StreamRing::fence() {
+	if (!persistent || buffer == 0)
+		return;
+
+	if (fences[region])
+		glDeleteSync(fences[region]);
+
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamRing::release() {
+	for (unsigned int i = 0; i < STREAM_FRAMES; i++) {
+		if (fences[i])
+			glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+
+	buffer = 0;
+	mapped = NULL;
+	regionSize = 0;
+	staging.clear();
+}
+
+
+// grows every region to fit bytes (doubling, so a growing scene only reallocates a few times)
+void StreamRing::allocate(size_t bytes) {
+	for (unsigned int i = 0; i < STREAM_FRAMES; i++)
+		waitForRegion(i);
+
+	regionSize = std::max(bytes, regionSize * 2);
+	regionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+	// the new name is taken before the old one is freed, so meshes caching the old binding always rebind
+	GLuint oldBuffer = buffer;
+	glGenBuffers(1, &buffer);
+	if (oldBuffer)
+		glDeleteBuffers(1, &oldBuffer);
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glBindBuffer(target, buffer);
+	glBufferStorage(target, regionSize * STREAM_FRAMES, NULL, flags);
+	mapped = (unsigned char*)glMapBufferRange(target, 0, regionSize * STREAM_FRAMES, flags);
+	glBindBuffer(target, 0);
+
+	stats.resizes++;
+}
+
+void StreamRing::waitForRegion(unsigned int index) {
+	if (!fences[index])
+		return;
+
+	// already signalled unless the CPU is a full ring ahead
+	GLenum status = glClientWaitSync(fences[index], 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		stats.waits++;
+
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+	}
+
+	glDeleteSync(fences[index]);
+	fences[index] = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef STREAMRING_H
+#define STREAMRING_H
+
+#include <vector>
+#include <GL/glew.h>
+
+
+///////////////////////////////////////////////////
+// Stream Ring
+// A buffer the CPU rewrites every frame. It is split into one region per frame
+// in flight and mapped once for good (GL_ARB_buffer_storage, persistent and
+// coherent), so writing a frame's data is a plain memory copy. A fence placed
+// after the frame's draws guards each region, and the CPU only waits when it
+// gets a full ring ahead of the GPU.
+// Without buffer storage the buffer is orphaned and refilled every frame instead.
+
+const unsigned int STREAM_FRAMES = 3;
+
+// Counters since the ring was created
+struct StreamStats {
+	unsigned int waits = 0;		// frames the CPU had to wait for the GPU to release a region
+	unsigned int resizes = 0;
+};
+
+
+class StreamRing {
+public:
+	StreamStats stats;
+
+	// target the buffer is bound to while it is written (it can be bound anywhere to be read)
+	explicit StreamRing(GLenum target = GL_ARRAY_BUFFER) : target(target) {}
+
+	// region of this frame with room for bytes, waits for the GPU to finish with it first
+	void* map(size_t bytes);
+
+	// call once the region is written and before it is drawn from
+	void unmap();
+
+	// call after the draws reading the region, the region is reused STREAM_FRAMES frames later
+	void fence();
+
+	// deletes the buffer and fences (call before the context is destroyed)
+	void release();
+
+	GLuint getBuffer() const { return buffer; }
+	GLintptr getOffset() const { return persistent ? (GLintptr)(region * regionSize) : 0; }	// start of this frame's region
+	bool isPersistent() const { return persistent; }
+private:
+	GLenum target;
+	GLuint buffer = 0;
+	bool persistent = false;
+	unsigned char* mapped = NULL;
+	size_t regionSize = 0;
+	size_t alignment = 1;
+	unsigned int region = 0;
+	GLsync fences[STREAM_FRAMES] = {};
+
+	std::vector<unsigned char> staging;	// frame data without buffer storage
+	size_t stagedBytes = 0;
+
+	void allocate(size_t bytes);
+	void waitForRegion(unsigned int index);
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "VertexFormat.h"
+
+#include <cstring>
+
+
+///////////////////////////////////////////////////
+// Forward Declarations
+VertexAttribute createAttribute(GLint size, GLenum type, GLboolean normalised, GLsizei bytes);
+template<size_t Bytes> void copyElements(unsigned char* dest, const unsigned char* src, size_t numVertices, GLsizei stride);
+
+
+VertexFormat createVertexFormat(VertexPrecision precision, VertexLayout layout, bool hasNormals, bool hasUvs, GLsizei strideAlignment) {
+	VertexFormat format;
+	format.layout = layout;
+
+	if (precision == VertexPrecision::QUANTIZED) {
+		// positions are padded to 4 components to keep vertices 4 byte aligned
+		format.attributes[TRIANGLES] = createAttribute(3, GL_UNSIGNED_SHORT, GL_TRUE, 4 * sizeof(GLushort));
+		if (hasNormals)
+			format.attributes[NORMALS] = createAttribute(4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(GLuint));
+		if (hasUvs)
+			format.attributes[TEXTURES] = createAttribute(2, GL_HALF_FLOAT, GL_FALSE, 2 * sizeof(GLhalf));
+	}
+	else {
+		format.attributes[TRIANGLES] = createAttribute(3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat));
+		if (hasNormals)
+			format.attributes[NORMALS] = createAttribute(3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat));
+		if (hasUvs)
+			format.attributes[TEXTURES] = createAttribute(2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat));
+	}
+
+	///////////////////////////////////////////////////
+	// Offsets within an interleaved vertex
+	size_t offset = 0;
+
+	for (unsigned int i = 0; i < NUM_VERTEX_BUFFERS; i++) {
+		if (!format.attributes[i].enabled)
+			continue;
+
+		format.attributes[i].offset = offset;
+		offset += format.attributes[i].bytes;
+	}
+
+	if (strideAlignment < 1)
+		strideAlignment = 1;
+
+	format.stride = (GLsizei)((offset + strideAlignment - 1) / strideAlignment * strideAlignment);
+
+	return format;
+}
+
+GLsizei getAttributeStride(const VertexFormat& format, unsigned int slot) {
+	if (format.layout == VertexLayout::INTERLEAVED)
+		return format.stride;
+
+	return format.attributes[slot].bytes;
+}
+
+std::vector<unsigned char> interleaveVertices(const VertexFormat& format, const std::vector<unsigned char> streams[NUM_VERTEX_BUFFERS], size_t numVertices) {
+	std::vector<unsigned char> vertices(numVertices * format.stride, 0);
+
+	for (unsigned int i = 0; i < NUM_VERTEX_BUFFERS; i++) {
+		const VertexAttribute& attribute = format.attributes[i];
+		if (!attribute.enabled || streams[i].size() < numVertices * attribute.bytes)
+			continue;
+
+		unsigned char* dest = vertices.data() + attribute.offset;
+		const unsigned char* src = streams[i].data();
+
+		// a memcpy of a constant size compiles to plain moves, a variable one is a call per vertex
+		switch (attribute.bytes) {
+		case 4:  copyElements<4>(dest, src, numVertices, format.stride); break;
+		case 8:  copyElements<8>(dest, src, numVertices, format.stride); break;
+		case 12: copyElements<12>(dest, src, numVertices, format.stride); break;
+		default:
+			for (size_t v = 0; v < numVertices; v++)
+				memcpy(dest + v * format.stride, src + v * attribute.bytes, attribute.bytes);
+		}
+	}
+
+	return vertices;
+}
+
+
+template<size_t Bytes>
+void copyElements(unsigned char* dest, const unsigned char* src, size_t numVertices, GLsizei stride) {
+	for (size_t v = 0; v < numVertices; v++) {
+		memcpy(dest, src, Bytes);
+		dest += stride;
+		src += Bytes;
+	}
+}
+
+VertexAttribute createAttribute(GLint size, GLenum type, GLboolean normalised, GLsizei bytes) {
+	VertexAttribute attribute;
+	attribute.enabled = true;
+	attribute.size = size;
+	attribute.type = type;
+	attribute.normalised = normalised;
+	attribute.bytes = bytes;
+
+	return attribute;
+}
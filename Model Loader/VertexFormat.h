@@ -0,0 +1,60 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <vector>
+#include <GL/glew.h>
+
+
+///////////////////////////////////////////////////
+// DataTypes
+// Attribute formats used when uploading the vertex data
+enum class VertexPrecision {
+	FULL,		// float positions, normals and uvs (32 bytes per vertex)
+	QUANTIZED	// unorm16 positions, 2_10_10_10 normals, half float uvs (16 bytes per vertex)
+};
+
+// How the attributes of a mesh are arranged in the model buffer
+enum class VertexLayout {
+	PLANAR,		// one array per attribute
+	INTERLEAVED	// one array of whole vertices
+};
+
+// Attribute slots, also used as the shader attribute locations
+enum VertexBufferValue {
+	TRIANGLES,
+	NORMALS,
+	TEXTURES,
+	COLOUR,
+	NUM_VERTEX_BUFFERS
+};
+
+// per-instance model matrix, one location per column (4 - 7)
+const GLuint INSTANCE_TRANSFORM_LOCATION = NUM_VERTEX_BUFFERS;
+
+struct VertexAttribute {
+	bool enabled = false;
+	GLint size = 0;						// number of components
+	GLenum type = GL_FLOAT;
+	GLboolean normalised = GL_FALSE;
+	GLsizei bytes = 0;					// size of one element, including padding
+	size_t offset = 0;					// offset within an interleaved vertex
+};
+
+// Vertex format descriptor
+struct VertexFormat {
+	VertexLayout layout = VertexLayout::INTERLEAVED;
+	VertexAttribute attributes[NUM_VERTEX_BUFFERS];
+	GLsizei stride = 0;					// size of an interleaved vertex, including padding
+};
+
+
+// strides of interleaved formats are rounded up to a multiple of strideAlignment
+VertexFormat createVertexFormat(VertexPrecision precision, VertexLayout layout, bool hasNormals, bool hasUvs, GLsizei strideAlignment = 4);
+
+// distance between two elements of an attribute in the buffer
+GLsizei getAttributeStride(const VertexFormat& format, unsigned int slot);
+
+// builds the interleaved vertex array from one tightly packed stream per attribute
+std::vector<unsigned char> interleaveVertices(const VertexFormat& format, const std::vector<unsigned char> streams[NUM_VERTEX_BUFFERS], size_t numVertices);
+
+#endif
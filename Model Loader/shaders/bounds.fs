@@ -0,0 +1,8 @@
+#version 330 core
+// Colour writes are masked while the boxes are drawn, only the samples passing the depth test are counted
+out vec4 fragColour;
+
+void main()
+{
+    fragColour = vec4(1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+// Bounding boxes drawn for occlusion queries (see OcclusionQueries.h)
+layout (location = 0) in vec3 aPos; // corner of a unit cube, -1 to 1
+
+uniform mat4 boxTransform; // projection * view * box
+
+void main()
+{
+    gl_Position = boxTransform * vec4(aPos, 1.0);
+}
@@ -1,27 +1,80 @@
 #version 330 core
+// Variants are compiled with TEXTURED, ALPHA_MAPPED, VERTEX_COLOUR, QUANTIZED, INSTANCED, MULTI_DRAW and LIT defines (see ShaderRegistry.h)
 out vec4 fragColour;
 
-struct Material {       
-    float shininess;    // Ns
-    vec3 ambient;       // Ka
-    vec4 diffuse;       // Kd
-    vec3 specular;      // Ks
-    float transparency; // d
-}; 
+// every loaded material, written once at load time (MaterialTable.h)
+const int MAX_MATERIALS = 256;
 
-//in vec3 vecColour;
+struct MaterialData {
+    vec4 ambient;   // Ka, w = Ns
+    vec4 diffuse;   // Kd
+    vec4 specular;  // Ks, w = illum
+    vec4 emissive;  // Ke, w = d
+};
+layout (std140) uniform Materials {
+    MaterialData materials[MAX_MATERIALS];
+};
+
+#if defined(TEXTURED) || defined(ALPHA_MAPPED)
 in vec2 texCoord;
+#endif
+#ifdef VERTEX_COLOUR
+in vec4 vecColour;
+#endif
+#ifdef LIT
+in vec3 worldNormal;
+in vec3 worldPosition;
+// written once per frame (FrameUniforms.h)
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+const float AMBIENT_LIGHT = 0.2;
+#endif
 
+#ifdef TEXTURED
 uniform sampler2D texture_diffuse1;
-uniform bool hasTexture;
-uniform Material material;
+#endif
+#ifdef ALPHA_MAPPED
+uniform sampler2D texture_alpha1;
+#endif
+#ifdef MULTI_DRAW
+// material of the draw command, from the vertex shader
+flat in int drawMaterial;
+#else
+uniform int materialIndex;
+#endif
 
 void main()
 {
-    if(hasTexture) {
-        fragColour = texture(texture_diffuse1, texCoord);
-    }
-    else {
-        fragColour = vec4(material.diffuse);
-    }
-}
\ No newline at end of file
+#ifdef MULTI_DRAW
+    MaterialData material = materials[drawMaterial];
+#else
+    MaterialData material = materials[materialIndex];
+#endif
+#if defined(TEXTURED)
+    fragColour = texture(texture_diffuse1, texCoord);
+#elif defined(VERTEX_COLOUR)
+    fragColour = vecColour;
+#else
+    fragColour = material.diffuse;
+#endif
+#ifdef LIT
+    // Blinn-Phong with a light at the camera, so the half vector is the view vector
+    // (lit from whichever side is seen, the models do not agree on winding)
+    vec3 toCamera = normalize(cameraPosition.xyz - worldPosition);
+    float facing = abs(dot(normalize(worldNormal), toCamera));
+
+    vec3 colour = material.ambient.rgb * AMBIENT_LIGHT * fragColour.rgb + fragColour.rgb * facing + material.emissive.rgb;
+    // illum 2 and up adds the highlight
+    if (material.specular.w >= 2.0)
+        colour += material.specular.rgb * pow(facing, max(material.ambient.w, 1.0));
+    fragColour.rgb = colour;
+#endif
+#ifdef ALPHA_MAPPED
+    fragColour.a = texture(texture_alpha1, texCoord).r;
+#endif
+    fragColour.a *= material.emissive.w;
+}
@@ -1,18 +1,83 @@
 #version 330 core
+// Variants are compiled with TEXTURED, ALPHA_MAPPED, VERTEX_COLOUR, QUANTIZED, INSTANCED, MULTI_DRAW and LIT defines (see ShaderRegistry.h)
+#if defined(TEXTURED) || defined(ALPHA_MAPPED)
+#define HAS_UVS
+#endif
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shading_language_420pack : require
+#endif
+
 layout (location = 0) in vec3 aPos;
-//layout (location = 1) in vec3 aColour;
+#ifdef LIT
+layout (location = 1) in vec3 aNormal;
+out vec3 worldNormal;
+out vec3 worldPosition;
+#endif
+#ifdef HAS_UVS
 layout (location = 2) in vec2 aTexCoord;
-
-//out vec3 vecColour;
 out vec2 texCoord;
+#endif
+#ifdef VERTEX_COLOUR
+layout (location = 3) in vec4 aColour;
+out vec4 vecColour;
+#endif
 
+#if defined(MULTI_DRAW)
+// one transform per instance (indexed by base instance) and one DrawData per command (indexed by gl_DrawID)
+struct DrawData {
+    vec4 positionScale;
+    vec4 positionOffset;
+    int material;
+};
+layout (std430, binding = 0) readonly buffer Transforms { mat4 transforms[]; };
+layout (std430, binding = 1) readonly buffer Draws { DrawData draws[]; };
+uniform int drawOffset; // first command of this multi draw
+flat out int drawMaterial;
+#elif defined(INSTANCED)
+layout (location = 4) in mat4 model; // per instance, locations 4 - 7
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+// written once per frame (FrameUniforms.h)
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+#if defined(QUANTIZED) && !defined(MULTI_DRAW)
+// rebuilds quantized positions from the mesh bounds
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+#endif
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-	//vecColour = aColour;
-	texCoord = vec2(aTexCoord.x, aTexCoord.y);
+#ifdef MULTI_DRAW
+    DrawData draw = draws[drawOffset + gl_DrawIDARB];
+    mat4 model = transforms[gl_BaseInstanceARB + gl_InstanceID];
+    vec3 positionScale = draw.positionScale.xyz;
+    vec3 positionOffset = draw.positionOffset.xyz;
+    drawMaterial = draw.material;
+#endif
+#ifdef QUANTIZED
+    vec3 position = aPos * positionScale + positionOffset;
+#else
+    vec3 position = aPos;
+#endif
+    gl_Position = projection * view * model * vec4(position, 1.0);
+#ifdef LIT
+    // models are only scaled uniformly, so the model matrix carries normals too
+    worldNormal = mat3(model) * aNormal;
+    worldPosition = vec3(model * vec4(position, 1.0));
+#endif
+#ifdef HAS_UVS
+	texCoord = aTexCoord;
+#endif
+#ifdef VERTEX_COLOUR
+	vecColour = aColour;
+#endif
 }
\ No newline at end of file